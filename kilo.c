@@ -24,6 +24,39 @@
 #include <stdarg.h>
 #include <fcntl.h>
 #include <stdbool.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <pthread.h>
+#include <sys/inotify.h>
+#include <sys/resource.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
+
+// the benchmark build counts every allocation
+//
+#ifdef KILO_BENCH
+unsigned long editorBenchAllocs;
+static void *editorBenchMalloc(size_t n) { editorBenchAllocs++; return malloc(n); }
+static void *editorBenchCalloc(size_t n, size_t size) { editorBenchAllocs++; return calloc(n, size); }
+static void *editorBenchRealloc(void *p, size_t n) { editorBenchAllocs++; return realloc(p, n); }
+#define malloc editorBenchMalloc
+#define calloc editorBenchCalloc
+#define realloc editorBenchRealloc
+
+// when a measured run started and how many
+// allocations had been made by then
+//
+struct editorBenchClock {
+  struct timespec start;
+  unsigned long allocs;
+};
+#endif
 
 /* Definitions */
 
@@ -48,21 +81,108 @@
 //
 #define KILO_QUIT_TIMES 3
 
+// number of buffers that keep their render and
+// highlight caches when they are not being shown
+//
+#define KILO_RESIDENT_BUFFERS 2
+
 // flags to enable highlights
 //
 #define HL_HIGHLIGHT_NUMBERS (1<<0)
 #define HL_HIGHLIGHT_STRINGS (1<<1)
+#define HL_HIGHLIGHT_STRUCTURE (1<<2)
+
+// state a row leaves the structure parser in, a preprocessor
+// line continued on the next row and a typedef that has not
+// reached its name yet, with the brace depth above that
+//
+#define PS_CONTINUE (1<<0)
+#define PS_TYPEDEF (1<<1)
+#define PS_DEPTH_SHIFT 2
+
+// directory holding the shipped syntax definition files
+//
+#ifndef KILO_SYNTAX_DIR
+#define KILO_SYNTAX_DIR "/usr/local/share/kilo/syntax"
+#endif
+
+// milliseconds the rest of an escape sequence gets to arrive
+// in before a lone escape is taken as the escape key
+//
+#ifndef KILO_ESC_TIMEOUT
+#define KILO_ESC_TIMEOUT 50
+#endif
+
+// identifies a compiled syntax database and the layout of it
+//
+#define KILO_SYNTAX_MAGIC "KILOSYN1"
+#define KILO_SYNTAX_VERSION 1
+
+// most rows the background highlighter works on ahead
+// of the viewport at once
+//
+#define KILO_HL_BATCH 4096
+
+// rotate a 64 bit hash left
+//
+#define ROTL64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+// identifies what a row highlight was computed from, the
+// version of the row contents and the comment state it started in
+//
+#define HL_KEY(ver, in) ((ver) << 1 | (unsigned long)((in) != 0))
+
+// rows the large file viewer keeps loaded around the cursor
+// and how close the cursor gets to either end of them before
+// the window moves
+//
+#define KILO_VIEW_WINDOW 1024
+#define KILO_VIEW_MARGIN 128
+
+// lines between entries of the viewer line index, bytes the
+// scan reads before it lets go of them and the longest part
+// of a line the viewer loads
+//
+#define KILO_VIEW_STRIDE 4096
+#define KILO_VIEW_CHUNK (1 << 20)
+#define KILO_VIEW_LINE_MAX 65536
+
+// bytes a followed file is read in at once
+//
+#define KILO_FOLLOW_CHUNK 65536
+
+// most rows a reload tries to match up one by one before
+// replacing everything between the unchanged ends, the
+// diff keeps about its square in ints while it looks
+//
+#define KILO_RELOAD_MAX_EDITS 1024
+
+// most cursors multi cursor editing adds at once
+//
+#define KILO_MAX_CURSORS 100000
+
+// size of the screen kept in memory when running headless
+//
+#define KILO_HEADLESS_ROWS 24
+#define KILO_HEADLESS_COLS 80
+
+// milliseconds a headless run waits for the background
+// highlighter to send back rows before it reports
+//
+#define KILO_HEADLESS_SETTLE 2000
+
+// milliseconds the memory line on the status bar is kept
+// before the rows are counted again
+//
+#define KILO_MEMORY_REFRESH 1000
 
-// Python filename extensions
+// buckets of the latency histograms, eight to every
+// doubling which keeps percentiles within 1/8
 //
-// char *Python_HL_extensions[] = { ".py", NULL };
-// char *Python_HL_keywords[] = {
-// "def","str","return","if", "while", "elif", "else", "class", "import", "as",
-// "from", "open", "insert", 
-// "for|", "list|", "set|", "append|", "add|", "range|", "len|", NULL
-// };
+#define KILO_STATS_BUCKETS 512
 
 // C filename extensions
+// used when no syntax definition files are found
 //
 char *C_HL_extensions[] = { ".c", ".h", ".cpp", NULL };
 char *C_HL_keywords[] = {
@@ -80,6 +200,8 @@ char *C_HL_keywords[] = {
 // constants for the arrow keys mapped to
 // integers
 //
+// traces store these numbers, new keys go at the end
+//
 enum editorKey {
   BACKSPACE = 127,
   ARROW_LEFT = 1000,
@@ -93,6 +215,15 @@ enum editorKey {
   PAGE_DOWN
 };
 
+// modifiers held with a key, or'ed into it
+//
+enum editorKeyModifier {
+  KEY_SHIFT = 1 << 16,
+  KEY_ALT = 1 << 17,
+  KEY_CTRL = 1 << 18,
+  KEY_MODIFIERS = KEY_SHIFT | KEY_ALT | KEY_CTRL
+};
+
 // highlighter enumeration
 //
 enum editorHighlight {
@@ -103,9 +234,119 @@ enum editorHighlight {
   HL_KEYWORD2,
   HL_STRING,
   HL_NUMBER,
-  HL_MATCH
+  HL_MATCH,
+  HL_TYPE,
+  HL_FUNCTION,
+  HL_MACRO,
+  HL_PREPROC
+};
+
+// kinds of structure the row parser finds
+// names are looked up as macros and types when they are drawn
+// and calls are drawn as functions unless they are macros
+//
+enum editorNodeKind {
+  NODE_PREPROC = 0,
+  NODE_NAME,
+  NODE_CALL
+};
+
+// kinds of bracket the bracket index follows
+//
+enum editorBracketKind {
+  BR_PAREN = 0,
+  BR_SQUARE,
+  BR_BRACE,
+  BR_KINDS
+};
+
+// how a run of rows changes the nesting of each kind of bracket
+// d is the change in depth over the run, m the lowest depth it
+// reaches reading forwards and rm the lowest reading backwards
+// with closing brackets going up
+//
+struct editorBracketSum {
+  int d[BR_KINDS];
+  int m[BR_KINDS];
+  int rm[BR_KINDS];
+};
+
+// tree of bracket sums over the rows, the rows themselves are the
+// leaves and node g sums the rows from g minus its lowest set bit
+// up to g plus it, so there is one node for each gap between rows
+// and a node keeps its place while rows after it come and go,
+// nodes over rows from from on are summed again before use
+//
+struct editorBrackets {
+  struct editorBracketSum *tree;
+  int numrows;
+  int from;
+};
+
+// a folded region, the rows after start up to end are hidden
+// and folds are kept sorted and apart from each other so the
+// one holding a row is found by bisection
+//
+struct editorFold {
+  int start;
+  int end;
+};
+
+struct editorFolds {
+  struct editorFold *f;
+  int n;
+  int cap;
+};
+
+// a piece of structure within a row
+//
+struct editorNode {
+  int start;
+  int len;
+  int kind;
+};
+
+// a name defined somewhere in the buffer, macros and types
+// count the rows defining it as each
+//
+struct editorSymbol {
+  char *name;
+  int len;
+  uint32_t hash;
+  int macros;
+  int types;
+};
+
+// every name ever defined in a buffer, table maps hashes to
+// indexes into syms with mask + 1 slots and -1 marking an
+// empty one, symbols stay when nothing defines them anymore
+//
+struct editorSymbols {
+  struct editorSymbol *syms;
+  int n;
+  int cap;
+  int *table;
+  uint32_t mask;
+};
+
+// the characters of a row are shared with the clipboard and
+// with rows pasted from it, refs counts who holds them and text
+// held more than once is copied before it is changed, rsize and
+// hash are the render size and hash of the characters once a
+// row worked them out so rows pasted from the text can skip it,
+// rsize is below zero until then
+//
+struct editorText {
+  int refs;
+  int rsize;
+  uint64_t hash;
+  char chars[];
 };
 
+// the text the characters of a row are part of
+//
+#define TEXT_OF(c) ((struct editorText *)((c) - offsetof(struct editorText, chars)))
+
 // create a storage object for each row
 //
 typedef struct erow {
@@ -116,14 +357,430 @@ typedef struct erow {
   char *render;
   unsigned char *hl;
   int hl_open_comment;
+  unsigned long hlver;
+  unsigned long hl_done;
+  unsigned long hl_queued;
+  struct editorNode *nodes;
+  int nnodes;
+  int *defs;
+  int ndefs;
+  int ps_in;
+  int ps_out;
+  struct editorBracketSum br;
+  uint64_t hash;
 }erow;
 
+// soft wrap layout index
+// heights holds the number of visual lines each row takes up
+// tree is a fenwick tree over heights so that a visual line can
+// be mapped back to a row and an offset in O(log n)
+// n is the number of rows the index covers and cap its capacity
+// width is the wrap width the heights were computed for, a width
+// of zero means the index has not been built
+// stale is set when rows were inserted or removed, the tree is then
+// rebuilt from heights without laying out the rows again
+//
+struct editorLayout {
+  int *heights;
+  int *tree;
+  int n;
+  int cap;
+  int width;
+  int stale;
+};
+
+// what the editor last saw of a file on disk
+// wd is the inotify watch on it, mtime and size are what it
+// looked like when it was last read or written and changed is
+// set when an event came in for it since
+//
+struct editorDisk {
+  int wd;
+  struct timespec mtime;
+  off_t size;
+  int changed;
+};
+
+// tells whether a buffer still holds what was saved
+// link is the sum of a hash of every pair of neighbouring rows,
+// with no row before the first and after the last, so an edit
+// changes it in O(1), saved_link is what it was when the file
+// was last read or written and saved the hash of every row
+// back then to confirm a match, with room for capsaved
+//
+struct editorHashes {
+  uint64_t link;
+  uint64_t saved_link;
+  uint64_t *saved;
+  int nsaved;
+  int capsaved;
+};
+
+// where keys come from and frames go to, the real terminal
+// or a screen in memory playing a script of keys
+// open and close enter and leave raw mode, size reports the
+// screen, read returns 1 when it got a byte, write draws and
+// fd is readable when keys come in or -1 if one always is
+//
+struct editorTerminal {
+  void (*open)();
+  void (*close)();
+  int (*size)(int *rows, int *cols);
+  int (*read)(char *c);
+  int (*write)(const char *s, int len);
+  int fd;
+};
+
+// the screen in memory of a headless run
+// cells holds rows lines of cols characters and cy, cx
+// is where the next one goes
+// keys is the script played as input and pos how far
+// it got, an exhausted script reads as escapes so
+// prompts are cancelled
+// key_time is when the first key of the next frame was
+// read, latency holds how long every frame took from there
+// and bytes counts everything written
+//
+struct editorHeadless {
+  char *cells;
+  int rows, cols;
+  int cy, cx;
+  char *keys;
+  int nkeys;
+  int pos;
+  struct timespec key_time;
+  int key_pending;
+  long long *latency;
+  int frames;
+  int capframes;
+  long long bytes;
+};
+
+// a position in the buffer a cursor sits at
+//
+struct editorCursor {
+  int cx, cy;
+};
+
+// the cursors of multi cursor editing, kept sorted by position
+// with none sharing one, main is the one whose position is in
+// cx and cy of the config, no cursors means there is just that
+//
+struct editorCursors {
+  struct editorCursor *c;
+  int n;
+  int cap;
+  int main;
+};
+
+// the selection runs from the anchor to the cursor, ey and ex
+// are where the cursor was when the selection was last drawn
+//
+struct editorSelection {
+  int active;
+  int ay, ax;
+  int ey, ex;
+};
+
+// a piece of the text of a row the clipboard holds on to,
+// shared when it is the whole text of a row and text is
+// the counted text a new row can hold on to as well
+//
+struct editorSlice {
+  char *text;
+  int off;
+  int len;
+  int shared;
+};
+
+// what was copied as lines, the first and last can be parts
+// of rows and the ones in between are whole rows
+//
+struct editorClipboard {
+  struct editorSlice *lines;
+  int n;
+};
+
+// one byte of an escape sequence in the key decoder
+// child is the first byte that can follow it and sibling the
+// next one that can stand in its place, key is what the
+// sequence ending here decodes to or 0
+//
+struct editorKeyNode {
+  unsigned char byte;
+  int key;
+  int child;
+  int sibling;
+};
+
+// bytes read from the terminal that are not keys yet and the
+// trie of escape sequences they are decoded with, timeout is
+// how long the rest of a sequence gets to arrive
+//
+struct editorInput {
+  unsigned char buf[32];
+  int len;
+  int timeout;
+  struct editorKeyNode *nodes;
+  int nnodes;
+  int capnodes;
+};
+
+// descriptors the event loop waits on besides the terminal
+// and the workers, timer goes off when the status message
+// expires and signal reads a resize of the terminal
+//
+struct editorEvents {
+  int timer;
+  int signal;
+};
+
+// a session's keys as editorReadKey decoded them
+// record is the trace being written and start when the
+// session began, keys are the ones being replayed and pos
+// how far the replay got
+//
+struct editorTrace {
+  FILE *record;
+  long long start;
+  int replay;
+  int *keys;
+  int nkeys;
+  int pos;
+};
+
+// what the memory of the editor is spent on
+//
+enum editorMemoryKind {
+  MEM_ROWS = 0,
+  MEM_CHARS,
+  MEM_RENDER,
+  MEM_HL,
+  MEM_STRUCTURE,
+  MEM_LAYOUT,
+  MEM_BRACKETS,
+  MEM_FOLDS,
+  MEM_HASHES,
+  MEM_HIGHLIGHTER,
+  MEM_VIEW,
+  MEM_KINDS
+};
+
+// bytes asked for and blocks held by every kind, and
+// the size of the files they hold
+//
+struct editorMemory {
+  size_t bytes[MEM_KINDS];
+  size_t allocs[MEM_KINDS];
+  size_t filesize;
+};
+
+// the stages of getting from a keypress to the screen
+// that are timed
+//
+enum editorStage {
+  STAGE_READ = 0,
+  STAGE_PROCESS,
+  STAGE_SCROLL,
+  STAGE_DRAW,
+  STAGE_WRITE,
+  STAGE_PAINT,
+  STAGE_COUNT
+};
+
+// how long one stage took, count samples bucketed by
+// nanoseconds, their total and the longest
+//
+struct editorHistogram {
+  unsigned long count;
+  long long total;
+  long long max;
+  unsigned long buckets[KILO_STATS_BUCKETS];
+};
+
+// timings of every stage, show puts them in the status bar,
+// 1 for the latencies and 2 for the memory in use
+// and dump is the file they are written to on exit
+// reading is the time spent reading keys during the current
+// keypress and key_time is when the last key was read, the
+// next frame written paints it
+//
+struct editorStats {
+  struct editorHistogram stages[STAGE_COUNT];
+  int show;
+  char *dump;
+  long long reading;
+  long long key_time;
+  char memline[256];
+  int memlen;
+  long long memtime;
+};
+
+// a run of rows a reload replaces, da rows from row a of the
+// buffer make way for db lines from line b of the file
+//
+struct editorHunk {
+  int a, da;
+  int b, db;
+};
+
+// everything that belongs to one open file
+// the fields match the ones in the editor config and get
+// swapped in and out of it when switching buffers
+// evicted is set when the render and highlight caches of the
+// rows were freed while the buffer was in the background
+// lastused orders buffers for eviction
+//
+struct editorBuffer {
+  int cx, cy;
+  int rx;
+  int rowoff;
+  int coloff;
+  int numrows;
+  erow *row;
+  char *filename;
+  int dirty;
+  struct editorSyntax *syntax;
+  struct editorLayout layout;
+  int hl_frontier;
+  int hl_ahead;
+  struct editorSymbols symbols;
+  struct editorBrackets brackets;
+  struct editorFolds folds;
+  struct editorDisk disk;
+  struct editorHashes hashes;
+  int evicted;
+  unsigned long lastused;
+};
+
+// a row handed to the background highlighter
+// render is a copy of the row so the worker never looks at
+// the rows themselves, ver is the version of the row it was
+// copied from and in the comment state it starts in, queued
+// is the key the row was marked with when it was handed out
+// and buf the buffer the row is in, the worker fills in hl
+// and out, the state the row ends in
+//
+struct editorHighlightJob {
+  struct editorHighlightJob *next;
+  struct editorSyntax *syntax;
+  int buf;
+  int idx;
+  int urgent;
+  unsigned long ver;
+  unsigned long queued;
+  int in;
+  int out;
+  char *render;
+  int rsize;
+  unsigned char *hl;
+};
+
+// the background highlighter
+// urgent jobs are rows on the screen and are taken before the
+// rest, finished jobs go on the done list and a byte is written
+// to the pipe when it stops being empty so the input loop wakes
+// pending is the number of rows ahead of the viewport in flight
+//
+struct editorHighlighter {
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  struct editorHighlightJob *urgent, *urgent_tail;
+  struct editorHighlightJob *jobs, *jobs_tail;
+  struct editorHighlightJob *done, *done_tail;
+  int pipe[2];
+  int running;
+  int pending;
+};
+
+// a file too big to load shown read only through a window
+// of rows around the cursor
+// map is the whole file mapped read only and size its length
+// marks holds the offset of every stride-th line as the scan
+// finds them, lines and scanned are how far it got and done is
+// set once it reached the end, all of them are guarded by lock
+// base is the line number of the first loaded row, start its
+// offset and end the offset just past the last loaded row
+//
+struct editorView {
+  int active;
+  char *map;
+  size_t size;
+  pthread_t thread;
+  pthread_mutex_t lock;
+  size_t *marks;
+  size_t nmarks;
+  size_t capmarks;
+  size_t lines;
+  size_t scanned;
+  int done;
+  size_t base;
+  size_t start;
+  size_t end;
+};
+
+// a file followed as it grows
+// fd stays open to read what gets added and watch is the inotify
+// instance telling when that happens, offset is how much of the
+// file was read and open is set when the last row did not end
+// in a newline yet so more of it may come
+// buf is the buffer showing the file, it is only read into
+// while that buffer is the current one
+// maxrows is how many rows are kept, zero keeping all of them
+//
+struct editorFollow {
+  int active;
+  int fd;
+  int watch;
+  off_t offset;
+  int open;
+  int buf;
+  int maxrows;
+};
+
+// one view into the current buffer
+// cx, cy, rx, rowoff and coloff mirror the fields of the same
+// name in the editor config while the pane is not active
+// top, left, rows and cols place the pane on the screen
+// the drawn fields remember what the pane showed the last time
+// it was drawn and touched_lo to touched_hi is the range of rows
+// changed since then, so it is only redrawn when something it
+// shows changed
+//
+struct editorPane {
+  int cx, cy;
+  int rx;
+  int rowoff;
+  int coloff;
+  int top, left;
+  int rows, cols;
+  int drawn;
+  int drawn_rowoff;
+  int drawn_coloff;
+  int drawn_buf;
+  int drawn_wrap;
+  int touched;
+  int touched_lo;
+  int touched_hi;
+};
+
+// ways of splitting the screen into panes
+//
+enum editorSplit {
+  SPLIT_NONE = 0,
+  SPLIT_HORIZONTAL,
+  SPLIT_VERTICAL
+};
+
 // has 3 sets of flags for interfacing with io
 // cx and cy are cursor position
 // rx is a variable that compensates for tabs
 // rowoff is to keep track of what row the user is on in the text file
 // coloff is to keep track of what column the user is on in the text file
-// screenrows and screencols are the size of the terminal
+// screenrows and screencols are the size of the active pane
+// and screentop and screenleft are where it sits on the screen
+// termrows and termcols are the size of the whole text area
 // create a struct from the termios.h library
 // termios = declare the termios to hold terminal info
 // numrows is number of rows
@@ -133,6 +790,39 @@ typedef struct erow {
 // statusmsg_time is how long the message has been up
 // dirty is a integer to keep track of if the file has been edited
 // editorSyntax is a pointer to the syntax information
+// wrap is set when long rows are soft wrapped, rowoff then counts
+// visual lines instead of file rows
+// layout is the visual line index used while wrapping
+// buffers is the list of open files and curbuf the one that is
+// currently loaded into the fields above
+// panes are the views into the current buffer, curpane is the one
+// whose view is loaded into the config and split is how they
+// are laid out
+// hldb is the syntax database loaded at startup
+// hlworker highlights rows in the background, hlseq numbers
+// every version of every row, hl_defer leaves rows to the
+// worker while a file is loading, hl_hold leaves rows plain
+// until the caller colors them all at once, every row above hl_frontier
+// is highlighted and hl_ahead is the next row to hand out
+// symbols are the macros and types defined in the buffer
+// brackets indexes the brackets of the buffer and bracket_row
+// and bracket_col are where the one matching the bracket at
+// the cursor is
+// folds are the folded regions of the buffer
+// view is set up instead of the rows of a file when it is
+// opened read only with the large file viewer
+// follow keeps reading a file that is still being written
+// watch is the inotify instance watching the open files and
+// disk what the current one looked like on disk
+// hashes tell whether the rows still match the saved file
+// term is where keys are read from and frames written to and
+// headless the screen in memory when that is not a terminal
+// stats time the stages of every keypress
+// trace records or replays the keys of a session
+// events are the timer and signal the event loop wakes up on
+// input holds the bytes of keys still being decoded
+// cursors are the extra places typing goes to
+// sel is the selected text and clip what was last copied
 //
 struct editorConfig {
   int cx,cy;
@@ -141,6 +831,10 @@ struct editorConfig {
   int coloff;
   int screenrows;
   int screencols;
+  int screentop;
+  int screenleft;
+  int termrows;
+  int termcols;
   struct termios orig_termios;
   int numrows;
   erow *row;
@@ -149,6 +843,43 @@ struct editorConfig {
   time_t statusmsg_time;
   int dirty;
   struct editorSyntax *syntax;
+  int wrap;
+  struct editorLayout layout;
+  struct editorBuffer *buffers;
+  int numbuffers;
+  int curbuf;
+  unsigned long buftick;
+  struct editorPane panes[2];
+  int numpanes;
+  int curpane;
+  int split;
+  struct editorSyntax *hldb;
+  unsigned int hldb_entries;
+  struct editorHighlighter hlworker;
+  unsigned long hlseq;
+  int hl_defer;
+  int hl_hold;
+  int hl_frontier;
+  int hl_ahead;
+  struct editorSymbols symbols;
+  struct editorBrackets brackets;
+  int bracket_row;
+  int bracket_col;
+  struct editorFolds folds;
+  struct editorView view;
+  struct editorFollow follow;
+  int watch;
+  struct editorDisk disk;
+  struct editorHashes hashes;
+  struct editorTerminal *term;
+  struct editorHeadless headless;
+  struct editorStats stats;
+  struct editorTrace trace;
+  struct editorEvents events;
+  struct editorInput input;
+  struct editorCursors cursors;
+  struct editorSelection sel;
+  struct editorClipboard clip;
 };  
 
 // initialize the editor config
@@ -162,8 +893,148 @@ struct abuf {
   int len;
 };
 
+// a keyword in a compiled keyword table
+// hash is the hash of the word, name is its offset in the pool
+// with zero marking an empty slot, and kind is the highlight
+//
+struct editorKeyword {
+  uint32_t hash;
+  uint32_t name;
+  uint16_t len;
+  uint16_t kind;
+};
+
+// start of a compiled syntax database, followed by the entries
+// and then the pool of strings and tables they point into
+// everything is an offset so the file can be mapped as it is
+//
+struct editorSyntaxHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t entries;
+  uint64_t fingerprint;
+  uint32_t pool;
+  uint32_t size;
+};
+
+// one compiled language, every field is an offset into the pool
+// filematch and shebang are zero terminated arrays of offsets
+// keywords is a hash table of kwmask + 1 slots
+//
+struct editorSyntaxEntry {
+  uint32_t filetype;
+  uint32_t filematch;
+  uint32_t shebang;
+  uint32_t scs;
+  uint32_t mcs;
+  uint32_t mce;
+  uint32_t flags;
+  uint32_t keywords;
+  uint32_t kwmask;
+};
+
+// a language as read from a definition file before compiling
+// keywords of the second kind end with a bar
+//
+struct editorSyntaxDef {
+  char *filetype;
+  char **filematch;
+  int nfilematch;
+  char **shebangs;
+  int nshebangs;
+  char **keywords;
+  int nkeywords;
+  char *scs;
+  char *mcs;
+  char *mce;
+  int flags;
+};
+
+// states of the lexer, the ones below LS_ACTIONS come
+// straight out of the transition table
+// LS_SEP follows a separator, LS_WORD is inside a word and
+// LS_NUMBER inside a number
+//
+enum editorLexState {
+  LS_SEP = 0,
+  LS_WORD,
+  LS_NUMBER,
+  LS_ACTIONS,
+  LA_STRING = LS_ACTIONS,
+  LA_KEYWORD,
+  LS_MLCOMMENT
+};
+
+// classes of bytes the lexer tells apart
+// LC_DELIM bytes may start a comment and fall back to
+// their class in base when they don't
+//
+enum editorLexClass {
+  LC_SEP = 0,
+  LC_OTHER,
+  LC_DIGIT,
+  LC_DOT,
+  LC_QUOTE,
+  LC_DELIM,
+  LC_COUNT
+};
+
+// pack a transition into a byte as the highlight
+// of the byte and the state after it
+//
+#define LEX(state, hl) ((unsigned char)((hl) << 4 | (state)))
+
+// transitions between the lexer states for each class
+// of byte, a digit or a dot only continues a number and
+// a word after a separator has to be looked up
+//
+static const unsigned char editorLexTable[LS_ACTIONS][LC_COUNT] = {
+  [LS_SEP] = {
+    [LC_SEP] = LEX(LS_SEP, HL_NORMAL),
+    [LC_OTHER] = LA_KEYWORD,
+    [LC_DIGIT] = LEX(LS_NUMBER, HL_NUMBER),
+    [LC_DOT] = LEX(LS_SEP, HL_NORMAL),
+    [LC_QUOTE] = LA_STRING,
+  },
+  [LS_WORD] = {
+    [LC_SEP] = LEX(LS_SEP, HL_NORMAL),
+    [LC_OTHER] = LEX(LS_WORD, HL_NORMAL),
+    [LC_DIGIT] = LEX(LS_WORD, HL_NORMAL),
+    [LC_DOT] = LEX(LS_SEP, HL_NORMAL),
+    [LC_QUOTE] = LA_STRING,
+  },
+  [LS_NUMBER] = {
+    [LC_SEP] = LEX(LS_SEP, HL_NORMAL),
+    [LC_OTHER] = LEX(LS_WORD, HL_NORMAL),
+    [LC_DIGIT] = LEX(LS_NUMBER, HL_NUMBER),
+    [LC_DOT] = LEX(LS_NUMBER, HL_NUMBER),
+    [LC_QUOTE] = LA_STRING,
+  },
+};
+
+// a compiled lexer for one language
+// cls is the class of every byte and base the class a
+// delimiter byte falls back to, the delimiters are kept
+// with their lengths so they are only measured once
+//
+struct editorLexer {
+  unsigned char cls[256];
+  unsigned char base[256];
+  char *scs;
+  char *mcs;
+  char *mce;
+  int scs_len;
+  int mcs_len;
+  int mce_len;
+  struct editorSyntax *syntax;
+};
+
 // struct to hold filetype
 // that will hold the syntax
+// shebangs are interpreter names matched against the first line
+// kwtable is the compiled keyword hash table with kwmask + 1
+// slots whose names are in kwpool
+// lexer holds the tables the row lexer runs on
 //
 struct editorSyntax {
   char *filetype;
@@ -173,9 +1044,14 @@ struct editorSyntax {
   char *multiline_comment_start;
   char *multiline_comment_end;
   int flags;
+  char **shebangs;
+  const struct editorKeyword *kwtable;
+  uint32_t kwmask;
+  const char *kwpool;
+  struct editorLexer *lexer;
 };
 
-// highlight database
+// built in highlight database
 //
 struct editorSyntax HLDB[] = {
   {
@@ -183,7 +1059,8 @@ struct editorSyntax HLDB[] = {
     C_HL_extensions,
     C_HL_keywords,
     "//", "/*", "*/",
-    HL_HIGHLIGHT_NUMBERS | HL_HIGHLIGHT_STRINGS
+    HL_HIGHLIGHT_NUMBERS | HL_HIGHLIGHT_STRINGS | HL_HIGHLIGHT_STRUCTURE,
+    NULL, NULL, 0, NULL, NULL
   },
 };
 
@@ -194,6 +1071,52 @@ struct editorSyntax HLDB[] = {
 void enableRawMode();
 void disableRawMode();
 
+// terminal backends
+//
+int editorTtyRead(char *c);
+int editorTtyWrite(const char *s, int len);
+void editorHeadlessOpen();
+void editorHeadlessClose();
+int editorHeadlessSize(int *rows, int *cols);
+int editorHeadlessRead(char *c);
+int editorHeadlessWrite(const char *s, int len);
+void editorHeadlessKey();
+void editorHeadlessStart(char *keys, int nkeys, int rows, int cols);
+int editorHeadlessLoad(char *filename);
+int editorHeadlessPending();
+void editorHeadlessRun();
+int editorLatencyCompare(const void *a, const void *b);
+void editorHeadlessReport();
+
+// latency statistics
+//
+long long editorStatsClock();
+int editorStatsBucket(long long ns);
+long long editorStatsBucketEnd(int i);
+void editorStatsAdd(int stage, long long ns);
+long long editorStatsPercentile(struct editorHistogram *h, int pct);
+int editorStatsFormat(char *buf, int size, long long ns);
+int editorStatsLine(char *buf, int size);
+void editorStatsToggle();
+void editorStatsDump();
+
+// memory accounting
+//
+void editorMemoryAdd(struct editorMemory *m, int kind, size_t bytes);
+void editorMemoryBuffer(struct editorMemory *m, struct editorBuffer *b);
+void editorMemoryCount(struct editorMemory *m);
+size_t editorMemoryTotal(struct editorMemory *m);
+int editorMemoryFormat(char *buf, int size, size_t bytes);
+int editorMemoryLine(char *buf, int size);
+void editorMemoryReport(FILE *fp);
+
+// key traces
+//
+int editorTraceRecord(char *filename);
+void editorTraceWrite(int c, long long now);
+int editorTraceLoad(char *filename);
+int editorTraceNext();
+
 // error handling
 //
 void die(const char *s);
@@ -203,6 +1126,7 @@ void die(const char *s);
 void editorSetStatusMessage(const char *fmt, ...);
 void editorDrawStatusBar(struct abuf *ab);
 void editorDrawRows(struct abuf *ab);
+void editorDrawRowSegment(struct abuf *ab, erow *row, int start, int len);
 void editorDrawMessageBar(struct abuf *ab);
 
 // append buffer
@@ -214,35 +1138,230 @@ void abFree(struct abuf *ab);
 //
 void editorUpdateRow(erow *row);
 void editorInsertRow(int at, char *s, size_t len);
+void editorRowInit(int at, char *s, size_t len);
+void editorRowInitText(int at, char *text, size_t len);
+void editorRowRender(erow *row);
+void editorRowFill(erow *row);
+void editorInsertRows(int at, struct editorSlice *lines, int n);
+char *editorTextAlloc(const char *s, size_t len);
+char *editorTextRetain(char *chars);
+void editorTextRelease(char *chars);
+void editorRowReserve(erow *row, size_t extra);
+void editorAppendRows(char *s, size_t len);
 void editorRowInsertChar(erow *row, int at, int c);
+void editorRowInsertChars(erow *row, const int *at, int n, int c);
 void editorInsertChar(int c);
 void editorRowAppendString(erow *row, char *s, size_t len);
+void editorRowInsertString(erow *row, int at, const char *s, size_t len);
 int editorRowCxToRx(erow *row, int cx); // sets absolute tab spacing
 int editorRowRxToCx(erow *row, int rx); // converts back
 void editorfreerow(erow *row);
 void editorDelRow(int at);
+void editorDelRows(int a, int b);
 void editorRowDelChar(erow *row, int at);
+void editorRowDelChars(erow *row, const int *at, int n);
 void editorDelChar();
 void editorInsertNewline();
 void editorDeleteRight();
 
+// row hashing
+//
+uint64_t editorHash64(const char *s, size_t len);
+uint64_t editorHashLink(uint64_t a, uint64_t b);
+void editorHashInsertRow(int at);
+void editorHashSave();
+void editorHashSaveFrom(int drop, int from);
+int editorIsDirty();
+
+// soft wrap layout
+//
+int editorWrapWidth();
+int editorRowHeight(erow *row);
+void editorLayoutFree();
+void editorLayoutBuild();
+void editorLayoutEnsure();
+void editorLayoutInsertRows(int at, int n);
+void editorLayoutDeleteRows(int at, int n);
+void editorLayoutUpdateRow(int at);
+int editorLayoutLineOfRow(int at);
+int editorLayoutRowOfLine(int line, int *sub);
+int editorLayoutTotal();
+void editorToggleWrap();
+
+// syntax database
+//
+uint32_t editorSyntaxHash(const char *s, int len);
+int editorSyntaxKeyword(struct editorSyntax *syntax, const char *s, int len);
+void editorSyntaxDefFree(struct editorSyntaxDef *d);
+void editorSyntaxDefAdd(char ***list, int *n, const char *word, int len);
+int editorSyntaxDefParse(const char *path, struct editorSyntaxDef *d);
+uint32_t editorSyntaxPoolString(struct abuf *pool, const char *s);
+void editorSyntaxPoolAlign(struct abuf *pool);
+uint32_t editorSyntaxPoolList(struct abuf *pool, char **list, int n);
+void editorSyntaxCompile(struct editorSyntaxDef *defs, int ndefs, uint64_t fingerprint, struct abuf *blob);
+char **editorSyntaxAttachList(const char *pool, uint32_t off);
+int editorSyntaxValidString(const char *pool, uint32_t poolsize, uint32_t off);
+int editorSyntaxValidList(const char *pool, uint32_t poolsize, uint32_t off);
+int editorSyntaxValidEntry(const struct editorSyntaxEntry *e, const char *pool, uint32_t poolsize);
+int editorSyntaxAttach(const char *blob, size_t size, uint64_t fingerprint);
+int editorSyntaxCachePath(char *path, size_t size, int create);
+void editorSyntaxCacheWrite(struct abuf *blob);
+int editorSyntaxCacheLoad(uint64_t fingerprint);
+int editorSyntaxNameCompare(const void *a, const void *b);
+int editorSyntaxListFiles(char ***paths, uint64_t *fingerprint);
+void editorSyntaxInit();
+int editorSyntaxMatchShebang(struct editorSyntax *s);
+
 // Syntax Actions
 //
 void editorSelectSyntaxHighlight();
 int is_separator(int c);
 void editorUpdateSyntax(erow *row);
+void editorLexerCompile(struct editorSyntax *syntax);
+int editorLexLine(const struct editorLexer *lx, const char *render, int rsize, unsigned char *hl, int in_comment);
+#ifdef KILO_BENCH
+int editorHighlightBranchy(struct editorSyntax *syntax, const char *render, int rsize, unsigned char *hl, int in_comment);
+void editorBenchSyntax(char *filename);
+#endif
 int editorSyntaxToColor(int hl);
 
+// background highlighting
+//
+void *editorHighlightWorker(void *arg);
+void editorHighlightStart();
+void editorHighlightInvalidate(int at);
+int editorHighlightSubmit(int at, int urgent, int force);
+void editorHighlightSchedule();
+int editorHighlightPoll();
+int editorHighlightStale();
+void editorHighlightSettle(int timeout);
+
+// event loop
+//
+void editorEventsStart();
+int editorEventsWait(int timeout);
+void editorEventsTimer();
+void editorResize();
+
+// structure parsing
+//
+int editorSymbolFind(const char *s, int len, int create);
+void editorSymbolRef(int def, int delta);
+void editorSymbolsFree(struct editorSymbols *t);
+void editorParseClear(erow *row);
+int editorParseLine(erow *row, int in);
+void editorParseRows(erow *row, int force);
+unsigned char *editorParseOverlay(erow *row);
+
+// bracket index
+//
+int editorBracketKind(int c, int *open);
+int editorBracketIsCode(erow *row, int i);
+void editorBracketCombine(struct editorBracketSum *out, const struct editorBracketSum *a, const struct editorBracketSum *b);
+void editorBracketRefresh();
+void editorBracketUpdateRow(erow *row);
+void editorBracketSumRow(erow *row);
+void editorBracketInvalidate(int at);
+const struct editorBracketSum *editorBracketSpan(int lo, int len);
+int editorBracketFindForward(int lo, int len, int from, int k, int *depth);
+int editorBracketFindBackward(int lo, int len, int before, int k, int *depth);
+int editorBracketMatch(int at, int col, int *mrow, int *mcol);
+int editorBracketFoldEnd(int at);
+int editorBracketAtCursor(int *col);
+void editorBracketMark();
+void editorBracketJump();
+
+// code folding
+//
+int editorLayoutActive();
+int editorFoldFind(int at);
+int editorFoldHidden(int at);
+int editorFoldNext(int at);
+int editorFoldRegion(int at);
+void editorFoldSet(int start, int end, int on);
+void editorFoldToggle();
+void editorFoldInsertRows(int at, int n);
+void editorFoldDeleteRows(int at, int n);
+void editorFoldDrop();
+int editorDrawFoldMarker(struct abuf *ab, int at, int room);
+
+// large file viewer
+//
+void *editorViewScan(void *arg);
+void editorViewOpen(char *filename);
+size_t editorViewLineStart(size_t off);
+size_t editorViewNextLine(size_t off);
+int editorViewOffsetOfLine(size_t *line, size_t *start);
+size_t editorViewLineOfOffset(size_t off);
+void editorViewInsertRow(int at, size_t off);
+void editorViewLoad(size_t off, size_t line);
+void editorViewShift();
+void editorViewGoto(char *query);
+int editorViewFind(char *query, int dir);
+int editorViewAllows(int c);
+
+// following files
+//
+void editorFollowStart(char *filename, int maxrows);
+void editorFollowStop();
+int editorFollowRead();
+void editorFollowTrim(int n);
+
+// reloading changed files
+//
+void editorDiskStart();
+void editorDiskWatch();
+void editorDiskUnwatch();
+void editorDiskPoll();
+void editorDiskCheck();
+int editorReloadDiff(erow *rows, uint64_t *oh, uint64_t *nh, char **nl, int *nlen, int n, int m, struct editorHunk **hunks);
+int editorReloadMap(struct editorHunk *h, int nh, int row);
+void editorReload();
+
 // cursor actions
 //
 int getCursorPosition(int *rows, int *cols);
 void editorMoveCursor(int key);
+void editorMoveCursorVisual(int delta);
+void editorSetCursorLine(int line, int col);
+int editorCursorLine();
+void editorPageMove(int dir);
+void editorGotoLine();
+int editorGotoParse(const char *query, long long *value, int *percent);
 void editorFind();
 void editorMoveCursorBeginRow();
 void editorMoveCursorEndRow();
 void editorMoveCursorLeftWord();
 void editorMoveCursorRightWord();
 
+// multiple cursors
+//
+void editorCursorsTouch();
+void editorCursorsClear();
+int editorCursorCompare(const void *a, const void *b);
+void editorCursorsSort();
+void editorCursorsAdd(int cy, int cx);
+void editorCursorsFind();
+void editorCursorsBelow();
+void editorCursorsEdit(int key);
+void editorCursorsMove(int key);
+int editorCursorsKey(int c);
+void editorCursorsDraw(struct abuf *ab);
+
+// selection and clipboard
+//
+void editorSelectionToggle();
+void editorSelectionClear();
+void editorSelectionUpdate();
+int editorSelectionRange(int *y1, int *x1, int *y2, int *x2);
+int editorSelectionColumns(erow *row, int *from, int *to);
+int editorSelectionKeeps(int c);
+void editorSelectionCursors();
+void editorClipboardFree();
+void editorCopy();
+void editorCut();
+void editorPaste();
+
 // editor initalization and file handling
 //
 void initEditor();
@@ -251,9 +1370,38 @@ void editorSave();
 char *editorRowsToString(int *buflen);
 char *editorPrompt(char *prompt, void (*callback)(char *, int));
 
+// buffer list
+//
+void editorBufferStash(struct editorBuffer *b);
+void editorBufferLoad(struct editorBuffer *b);
+void editorBufferReset();
+void editorBufferNew();
+void editorBufferSwitch(int i);
+void editorBufferEvict(struct editorBuffer *b);
+void editorBufferEvictIdle();
+void editorBufferOpen();
+void editorBufferClose();
+
+// split panes
+//
+void editorPaneStash(struct editorPane *p);
+void editorPaneLoad(struct editorPane *p);
+void editorPanesLayout();
+void editorPanesReset();
+void editorPanesTouch(int lo, int hi);
+void editorPaneSwitch();
+void editorToggleSplit();
+int editorDrawPane(struct abuf *ab, struct editorPane *p);
+void editorDrawSeparators(struct abuf *ab);
+
 // kepypress actions
 //
+int editorKeyChild(int node, unsigned char byte, int create);
+void editorKeyAdd(const char *seq, int key);
+void editorInputInit();
+int editorInputFill(int timeout);
 int editorReadKey();
+int editorDecodeKey();
 void editorProcessKeypress();
 
 
@@ -262,6 +1410,17 @@ void editorProcessKeypress();
 void editorScroll();
 int getWindowSize(int *rows, int *cols);
 void editorRefreshScreen();
+void editorRenderScreen(struct abuf *ab);
+
+// benchmarks
+//
+#ifdef KILO_BENCH
+int editorBenchLine(long i, char *buf, int size);
+void editorBenchReset();
+void editorBenchStart(struct editorBenchClock *c);
+void editorBenchStop(struct editorBenchClock *c, long lines, const char *name, long ops, long long bytes);
+int editorBench(int argc, char **argv);
+#endif
 
 /* Functions */
 
@@ -321,9 +1480,11 @@ void enableRawMode() {
   // VMIN sets minimum number of bits to be read
   // VTIME sets maximum amount of time to wait before
   // read()
+  // reads never wait, the event loop waits for keys and
+  // for the rest of an escape sequence instead
   //
   raw.c_cc[VMIN] = 0;
-  raw.c_cc[VTIME] = 1;
+  raw.c_cc[VTIME] = 0;
 
   // sets parameters to what we declared above
   // with error handling
@@ -337,1992 +1498,8477 @@ void enableRawMode() {
 
 
 
-/* Set Bottom Bar Information */
+/* Terminal Backends */
 
-// ... makes a variadic function
-// means it can take any number of arguments
+// the real terminal on stdin and stdout
 //
-void editorSetStatusMessage(const char *fmt, ...) {
+struct editorTerminal editorTty = {
+  enableRawMode, disableRawMode, getWindowSize,
+  editorTtyRead, editorTtyWrite, STDIN_FILENO
+};
 
-  // intialize the variable this will be
-  // like a %d but take the string
-  // we give it
-  //
-  va_list ap;
+// a screen in memory fed from a script of keys
+//
+struct editorTerminal editorHeadlessTerm = {
+  editorHeadlessOpen, editorHeadlessClose, editorHeadlessSize,
+  editorHeadlessRead, editorHeadlessWrite, -1
+};
 
-  // sets the variable list to the characters
-  // in the message
-  //
-  va_start(ap, fmt);
+int editorTtyRead(char *c) {
+  return read(STDIN_FILENO, c, 1);
+}
 
-  // set the status message to the help message in a formatted
-  // way where we print he status 
-  //
-  vsnprintf(E.statusmsg, sizeof(E.statusmsg), fmt, ap);
-
-  // cleans up memory associated
-  // 
-  va_end(ap);
-
-  // get the time
-  //
-  E.statusmsg_time = time(NULL);
+int editorTtyWrite(const char *s, int len) {
+  return write(STDOUT_FILENO, s, len);
 }
 
-void editorDrawStatusBar(struct abuf *ab) {
+void editorHeadlessOpen() {
+}
 
-  // switch to inverted colors
-  //
-  abAppend(ab, "\x1b[7m", 4);
-  
-  // set a character array to hold the message
-  // and a character array for the current line number
-  //
-  char status[80], rstatus[80];
+void editorHeadlessClose() {
+}
 
-  // get how many characters would be needed to print the message
-  // and load it into the character array
-  //
-  int len = snprintf(status, sizeof(status), "%.20s - %d lines %s", E.filename ? E.filename : "[No Name]", E.numrows, E.dirty ? "(modified)" : "");
+int editorHeadlessSize(int *rows, int *cols) {
+  *rows = E.headless.rows;
+  *cols = E.headless.cols;
+  return 0;
+}
 
-  // get how manay characters would be needed and write the message
-  // into the character array
-  //
-  int rlen = snprintf(rstatus, sizeof(rstatus), "%s | %d/%d", E.syntax ? E.syntax->filetype : "no ft", E.cy + 1, E.numrows);
+void editorHeadlessKey() {
+  struct editorHeadless *h = &E.headless;
 
-  // compensate if message is longer than screen length
+  // the first key after a frame starts the clock
+  // for the next one
   //
-  if (len > E.screencols) {
-    len = E.screencols;
+  if (!h->key_pending) {
+    clock_gettime(CLOCK_MONOTONIC, &h->key_time);
+    h->key_pending = 1;
   }
+}
 
-  // write the message
-  //
-  abAppend(ab, status, len);
+int editorHeadlessRead(char *c) {
+  struct editorHeadless *h = &E.headless;
+  editorHeadlessKey();
+  *c = h->pos < h->nkeys ? h->keys[h->pos++] : '\x1b';
+  return 1;
+}
 
-  // set the row to be of spaces with a white
-  // background and keep track of how long the row is
-  //
-  while (len < E.screencols) {
-    if (E.screencols - len == rlen) {
-      abAppend(ab, rstatus, rlen);
-      break;
+int editorHeadlessWrite(const char *s, int len) {
+  struct editorHeadless *h = &E.headless;
+  h->bytes += len;
+
+  // play the escape sequences the editor uses
+  // onto the screen
+  //
+  for (int i = 0; i < len; i++) {
+    if (s[i] == '\x1b' && i + 1 < len && s[i + 1] == '[') {
+      int j = i + 2;
+      int n[2] = {0, 0};
+      int k = 0;
+      while (j < len && (isdigit((unsigned char)s[j]) || s[j] == ';' || s[j] == '?')) {
+        if (s[j] == ';' && k < 1) {
+          k++;
+        }
+        else if (isdigit((unsigned char)s[j])) {
+          n[k] = n[k] * 10 + s[j] - '0';
+        }
+        j++;
+      }
+      if (j == len) {
+        break;
+      }
+      switch (s[j]) {
+        case 'H':
+          h->cy = n[0] ? n[0] - 1 : 0;
+          h->cx = n[1] ? n[1] - 1 : 0;
+          break;
+        case 'K':
+          if (h->cy < h->rows && h->cx < h->cols) {
+            memset(&h->cells[h->cy * h->cols + h->cx], ' ', h->cols - h->cx);
+          }
+          break;
+        case 'J':
+          memset(h->cells, ' ', h->rows * h->cols);
+          break;
+        case 'C':
+          h->cx += n[0] ? n[0] : 1;
+          break;
+        case 'B':
+          h->cy += n[0] ? n[0] : 1;
+          break;
+      }
+      i = j;
     }
-    else{
-      abAppend(ab, " ", 1);
-      len++;
+    else if (s[i] == '\r') {
+      h->cx = 0;
+    }
+    else if (s[i] == '\n') {
+      h->cy++;
+    }
+    else {
+      if (h->cy < h->rows && h->cx < h->cols) {
+        h->cells[h->cy * h->cols + h->cx] = s[i];
+      }
+      h->cx++;
     }
   }
 
-  // switch to original colors
-  //
-  abAppend(ab, "\x1b[m", 3);
-
-  // print a new line after the status message
+  // every write is a whole frame, it answers
+  // the keys read since the last one
   //
-  abAppend(ab, "\r\n", 2);
+  if (h->key_pending) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (h->frames == h->capframes) {
+      h->capframes = h->capframes ? h->capframes * 2 : 256;
+      h->latency = realloc(h->latency, sizeof(long long) * h->capframes);
+    }
+    h->latency[h->frames++] = (now.tv_sec - h->key_time.tv_sec) * 1000000000LL + (now.tv_nsec - h->key_time.tv_nsec);
+    h->key_pending = 0;
+  }
+  return len;
 }
 
-void editorDrawRows(struct abuf *ab) {
-  
-  // number to keep track of which row 
-  // the loop is on
-  //
-  int y;
-  
-  // loop through the rows of the screen
-  // and write a tilda at the beginning of each line
-  //
-  for (y = 0; y < E.screenrows; y++) {
-    
-    // get user cursor position
-    //
-    int filerow = y + E.rowoff;
-
-    // check if user is outside of the file 
-    //
-    if (filerow >= E.numrows) {
-      
-      // if we are 1/3 the way down the screen
-      // and the number of rows is 0
-      //
-      if (E.numrows == 0 && y == E.screenrows / 3) {
-          
-        // print out a welcome message
-        //
-        char welcome[80];
+void editorHeadlessStart(char *keys, int nkeys, int rows, int cols) {
+  struct editorHeadless *h = &E.headless;
+
+  // an empty screen and the script to play
+  //
+  free(h->cells);
+  free(h->latency);
+  memset(h, 0, sizeof(*h));
+  h->rows = rows;
+  h->cols = cols;
+  h->cells = malloc(rows * cols);
+  memset(h->cells, ' ', rows * cols);
+  h->keys = keys;
+  h->nkeys = nkeys;
+  E.term = &editorHeadlessTerm;
+}
 
-        // return how many characters would have been written
-        // if the buffer was the right size
-        //
-        int welcomelen = snprintf(welcome, sizeof(welcome), "Text editor -- version %s", KILO_VERSION);
+int editorHeadlessLoad(char *filename) {
 
-        // adjust the size of the buffer and write it
-        //
-        if (welcomelen > E.screencols) {
-          welcomelen = E.screencols;
-        }
+  // read the whole script of keys
+  //
+  FILE *fp = fopen(filename, "rb");
+  if (!fp) {
+    return -1;
+  }
+  struct abuf ab = ABUF_INIT;
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+    abAppend(&ab, buf, n);
+  }
+  fclose(fp);
+  editorHeadlessStart(ab.b, ab.len, KILO_HEADLESS_ROWS, KILO_HEADLESS_COLS);
+  return 0;
+}
 
-        // find half way through the screen
-        //
-        int padding = (E.screencols - welcomelen) / 2;
+int editorHeadlessPending() {
 
-        // if padding exists
-        //
-        if (padding) {
+  // keys left in the script or the trace
+  //
+  if (E.trace.replay) {
+    return E.trace.pos < E.trace.nkeys;
+  }
+  return E.headless.pos < E.headless.nkeys;
+}
 
-          // append a tilda at the start of the line
-          // and compensate in the padding
-          //
-          abAppend(ab, "~", 1);
-          padding--;
-        
-        }
+void editorHeadlessRun() {
 
-        // print spaces until padding is 0
-        //
-        while (padding--) {
-          abAppend(ab, " ", 1);
-        }
+  // play the script a key at a time, the report
+  // comes out however the editor exits
+  //
+  atexit(editorHeadlessReport);
+  while (editorHeadlessPending()) {
+    long long start = editorStatsClock();
+    E.stats.reading = 0;
+    editorProcessKeypress();
+    editorStatsAdd(STAGE_PROCESS, editorStatsClock() - start - E.stats.reading);
+    editorRefreshScreen();
+  }
 
-        // write the message
-        //
-        abAppend(ab, welcome, welcomelen);
+  // let the background highlighter finish so the report
+  // tells whether any row was left behind
+  //
+  editorHighlightSettle(KILO_HEADLESS_SETTLE);
+  editorRefreshScreen();
+  exit(0);
+}
 
-      } 
-      
-      else {
+int editorLatencyCompare(const void *a, const void *b) {
+  long long x = *(const long long *)a;
+  long long y = *(const long long *)b;
+  return (x > y) - (x < y);
+}
 
-        // add a tilda to the beginning of the line
-        // 
-        abAppend(ab,"~",1);
+void editorHeadlessReport() {
+  struct editorHeadless *h = &E.headless;
 
-      }
+  // the screen as it was left
+  //
+  for (int y = 0; y < h->rows; y++) {
+    int len = h->cols;
+    while (len > 0 && h->cells[y * h->cols + len - 1] == ' ') {
+      len--;
     }
+    printf("%.*s\n", len, &h->cells[y * h->cols]);
+  }
 
-    else {
+  // how long keys took to reach the screen
+  //
+  long long total = 0;
+  for (int i = 0; i < h->frames; i++) {
+    total += h->latency[i];
+  }
+  qsort(h->latency, h->frames, sizeof(long long), editorLatencyCompare);
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  printf("keys %d frames %d bytes %lld bytes/frame %lld maxrss %ldkB\n",
+    E.trace.replay ? E.trace.pos : h->pos, h->frames, h->bytes,
+    h->frames ? h->bytes / h->frames : 0, ru.ru_maxrss);
+  if (h->frames) {
+    printf("latency ns mean %lld p50 %lld p99 %lld max %lld\n",
+      total / h->frames, h->latency[(h->frames * 50 + 99) / 100 - 1],
+      h->latency[(h->frames * 99 + 99) / 100 - 1], h->latency[h->frames - 1]);
+  }
+  if (E.syntax) {
+    printf("highlight stale %d of %d rows\n", editorHighlightStale(), E.numrows);
+  }
+  editorMemoryReport(stdout);
+  fflush(stdout);
+}
 
-      // set length to the row size while 
-      // compensating with the offset of the column
-      //
-      int len = E.row[filerow].rsize - E.coloff;
+/* End Terminal Backends */
 
-      // If that number is negative reset it 
-      // to the beginning of the column
-      //
-      if (len < 0){
-        len = 0;
-      }
 
 
-      // if the len is greater than a full row
-      // set the length to the maximum size
-      // of a row
-      //
-      if (len > E.screencols) {
-        len = E.screencols;
-      }
-      
-      // set a pointer to the character array
-      //
-      char *c = &E.row[filerow].render[E.coloff];
+/* Latency Statistics */
 
-      // set a pointer to the syntax array
-      //
-      unsigned char *hl = &E.row[filerow].hl[E.coloff]; 
+// names of the stages in the order they are timed
+//
+const char *editorStageNames[STAGE_COUNT] = {
+  "read", "process", "scroll", "draw", "write", "paint"
+};
 
-      // keep track of current color
-      //
-      int current_color = -1;
+long long editorStatsClock() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1000000000LL + t.tv_nsec;
+}
 
-      // index integer
-      //
-      int j;
+int editorStatsBucket(long long ns) {
 
-      // iterate through the row
-      //
-      for (j = 0; j < len; j++) {
-        
-        // if it is a nonprintable character
-        // print out an inverted question mark
-        if (iscntrl(c[j])) {
+  // small times get a bucket each, past that every
+  // doubling is split into eight
+  //
+  if (ns < 16) {
+    return ns < 0 ? 0 : ns;
+  }
+  int e = 4;
+  while ((ns >> (e + 1)) != 0) {
+    e++;
+  }
+  return (e - 2) * 8 + ((ns >> (e - 3)) & 7);
+}
 
-          char sym = '?';
-          abAppend(ab, "\x1b[7m", 4);
-          abAppend(ab, &sym, 1);
-          abAppend(ab, "\x1b[m", 3);
+long long editorStatsBucketEnd(int i) {
 
-          // return to normal
-          //
-          if (current_color != -1) {
-            char buf[16];
-            int clen = snprintf(buf, sizeof(buf), "\x1b[%dm", current_color);
-            abAppend(ab, buf, clen);
-          }
+  // first time past the bucket
+  //
+  i++;
+  if (i < 16) {
+    return i;
+  }
+  return (long long)(8 + i % 8) << (i / 8 - 1);
+}
 
-        }
-        
-        // append normal character
-        //
-        else if (hl[j] == HL_NORMAL) {
-          if (current_color != -1) {
-            abAppend(ab, "\x1b[39m", 5);
-            current_color = -1;
-          }
-          abAppend(ab, &c[j], 1);
-        }
-        
-        // otherwise make it the appropriate color
-        //
-        else {
-          int color = editorSyntaxToColor(hl[j]);
-          if (color != current_color) {
-            current_color = color;
-            char buf[16];
-            int clen = snprintf(buf, sizeof(buf), "\x1b[%dm", color);
-            abAppend(ab, buf, clen);
-          }
-          abAppend(ab, &c[j], 1);
-        }
-      } 
+void editorStatsAdd(int stage, long long ns) {
+  struct editorHistogram *h = &E.stats.stages[stage];
+  h->count++;
+  h->total += ns;
+  if (ns > h->max) {
+    h->max = ns;
+  }
+  h->buckets[editorStatsBucket(ns)]++;
+}
 
-      // return to normal
-      //
-      abAppend(ab, "\x1b[39m", 5);
+long long editorStatsPercentile(struct editorHistogram *h, int pct) {
+
+  // walk the buckets up to the sample with the given
+  // rank and report the end of its bucket
+  //
+  if (h->count == 0) {
+    return 0;
+  }
+  unsigned long rank = (h->count * pct + 99) / 100;
+  unsigned long seen = 0;
+  for (int i = 0; i < KILO_STATS_BUCKETS; i++) {
+    seen += h->buckets[i];
+    if (seen >= rank) {
+      long long end = editorStatsBucketEnd(i) - 1;
+      return end < h->max ? end : h->max;
     }
+  }
+  return h->max;
+}
 
-    // deletes part of the line
-    //
-    abAppend(ab, "\x1b[K", 3);
+int editorStatsFormat(char *buf, int size, long long ns) {
 
-    // deal with the last line of the terminal
-    //
-    abAppend(ab, "\r\n", 2);
+  // three digits at most and a unit
+  //
+  if (ns < 1000) {
+    return snprintf(buf, size, "%lldn", ns);
+  }
+  if (ns < 1000000) {
+    return snprintf(buf, size, "%.*fu", ns < 10000 ? 1 : 0, ns / 1e3);
   }
+  if (ns < 1000000000) {
+    return snprintf(buf, size, "%.*fm", ns < 10000000 ? 1 : 0, ns / 1e6);
+  }
+  return snprintf(buf, size, "%.1fs", ns / 1e9);
 }
 
-void editorDrawMessageBar(struct abuf *ab) {
+int editorStatsLine(char *buf, int size) {
+
+  // p50/p99/max of every stage, paint first since it
+  // is what the keypress feels like
+  //
+  static const int order[STAGE_COUNT] = {
+    STAGE_PAINT, STAGE_PROCESS, STAGE_SCROLL, STAGE_DRAW, STAGE_WRITE, STAGE_READ
+  };
+  int len = 0;
+  for (int k = 0; k < STAGE_COUNT && len < size; k++) {
+    struct editorHistogram *h = &E.stats.stages[order[k]];
+    char p50[16], p99[16], max[16];
+    editorStatsFormat(p50, sizeof(p50), editorStatsPercentile(h, 50));
+    editorStatsFormat(p99, sizeof(p99), editorStatsPercentile(h, 99));
+    editorStatsFormat(max, sizeof(max), h->max);
+    len += snprintf(buf + len, size - len, "%s%s %s/%s/%s", k ? " " : "", editorStageNames[order[k]], p50, p99, max);
+  }
+  return len < size ? len : size - 1;
+}
 
-  // clear message bar
-  //
-  abAppend(ab, "\x1b[K", 3);
+void editorStatsToggle() {
 
-  // find the length of the status message
+  // cycle from nothing to the latencies to the
+  // memory in use
   //
-  int msglen = strlen(E.statusmsg);
+  E.stats.show = (E.stats.show + 1) % 3;
+  if (E.stats.show == 1) {
+    editorSetStatusMessage("Latency p50/p99/max per stage");
+  }
+  else if (E.stats.show == 2) {
+    E.stats.memtime = 0;
+    editorSetStatusMessage("Memory bytes/blocks per kind and times the file size");
+  }
+  else {
+    editorSetStatusMessage("");
+  }
+}
 
-  // if it is longer than the screen
-  // compensate for that
+void editorStatsDump() {
+
+  // nothing asked for
   //
-  if (msglen > E.screencols) {
-    msglen = E.screencols;
+  if (E.stats.dump == NULL) {
+    return;
+  }
+  FILE *fp = fopen(E.stats.dump, "w");
+  if (!fp) {
+    return;
   }
 
-  // if it has been less than 5 secs, display
-  // the message
+  // a summary line for every stage in nanoseconds
+  // and then its histogram
   //
-  if (msglen && time(NULL) - E.statusmsg_time < 5)
-    abAppend(ab, E.statusmsg, msglen);
+  fprintf(fp, "%-8s %10s %12s %12s %12s %12s %12s\n", "stage", "count", "mean", "p50", "p90", "p99", "max");
+  for (int k = 0; k < STAGE_COUNT; k++) {
+    struct editorHistogram *h = &E.stats.stages[k];
+    fprintf(fp, "%-8s %10lu %12lld %12lld %12lld %12lld %12lld\n", editorStageNames[k], h->count,
+      h->count ? h->total / (long long)h->count : 0, editorStatsPercentile(h, 50),
+      editorStatsPercentile(h, 90), editorStatsPercentile(h, 99), h->max);
+  }
+  for (int k = 0; k < STAGE_COUNT; k++) {
+    struct editorHistogram *h = &E.stats.stages[k];
+    fprintf(fp, "\n%s\n", editorStageNames[k]);
+    for (int i = 0; i < KILO_STATS_BUCKETS; i++) {
+      if (h->buckets[i]) {
+        fprintf(fp, "%12lld %10lu\n", editorStatsBucketEnd(i), h->buckets[i]);
+      }
+    }
+  }
+  fclose(fp);
 }
 
-/* End Set Bottom Bar Information */
+/* End Latency Statistics */
 
 
 
-/* Error Handling */
+/* Memory Accounting */
 
-void die(const char *s) {
-  
-  // clear the screen
-  //
-  write(STDOUT_FILENO, "\x1b[2J", 4);
-  write(STDOUT_FILENO, "\x1b[H", 3);
+// names of the kinds of memory
+//
+const char *editorMemoryNames[MEM_KINDS] = {
+  "rows", "chars", "render", "hl", "structure", "layout",
+  "brackets", "folds", "hashes", "highlighter", "view"
+};
 
-  // perror prints an error message
-  //
-  perror(s);
-
-  // Exit the program
-  //
-  exit(1);
+void editorMemoryAdd(struct editorMemory *m, int kind, size_t bytes) {
+  m->bytes[kind] += bytes;
+  m->allocs[kind]++;
 }
 
-/* End Error Handling */
-
-
+void editorMemoryBuffer(struct editorMemory *m, struct editorBuffer *b) {
 
-/* Append Buffer */
+  // the rows and what hangs off every one of them,
+  // an evicted buffer has only the characters left
+  //
+  if (b->row) {
+    editorMemoryAdd(m, MEM_ROWS, sizeof(erow) * b->numrows);
+  }
+  for (int j = 0; j < b->numrows; j++) {
+    erow *row = &b->row[j];
+    m->filesize += row->size + 1;
 
-void abAppend(struct abuf *ab, const char *s, int len) {
+    // text shared between rows counts once, a
+    // share of it for each row that holds it
+    //
+    struct editorText *text = TEXT_OF(row->chars);
+    editorMemoryAdd(m, MEM_CHARS, (sizeof(struct editorText) + row->size + 1) / text->refs);
+    if (row->render) {
+      editorMemoryAdd(m, MEM_RENDER, row->rsize + 1);
+    }
+    if (row->hl) {
+      editorMemoryAdd(m, MEM_HL, row->rsize);
+    }
+    if (row->nodes) {
+      editorMemoryAdd(m, MEM_STRUCTURE, sizeof(struct editorNode) * row->nnodes);
+    }
+    if (row->defs) {
+      editorMemoryAdd(m, MEM_STRUCTURE, sizeof(int) * row->ndefs);
+    }
+  }
 
-  // add extra length to the buffer
+  // the indexes kept over the rows
   //
-  char *new = realloc(ab->b, ab->len + len);
+  struct editorSymbols *t = &b->symbols;
+  if (t->syms) {
+    editorMemoryAdd(m, MEM_STRUCTURE, sizeof(struct editorSymbol) * t->cap);
+  }
+  if (t->table) {
+    editorMemoryAdd(m, MEM_STRUCTURE, sizeof(int) * (t->mask + 1));
+  }
+  for (int i = 0; i < t->n; i++) {
+    editorMemoryAdd(m, MEM_STRUCTURE, t->syms[i].len);
+  }
+  if (b->layout.heights) {
+    editorMemoryAdd(m, MEM_LAYOUT, sizeof(int) * b->layout.cap);
+  }
+  if (b->layout.tree) {
+    editorMemoryAdd(m, MEM_LAYOUT, sizeof(int) * (b->layout.cap + 1));
+  }
+  if (b->brackets.tree) {
+    editorMemoryAdd(m, MEM_BRACKETS, sizeof(struct editorBracketSum) * b->brackets.numrows);
+  }
+  if (b->folds.f) {
+    editorMemoryAdd(m, MEM_FOLDS, sizeof(struct editorFold) * b->folds.cap);
+  }
+  if (b->hashes.saved) {
+    editorMemoryAdd(m, MEM_HASHES, sizeof(uint64_t) * b->hashes.capsaved);
+  }
+}
 
-  // if failed return
+void editorMemoryCount(struct editorMemory *m) {
+  memset(m, 0, sizeof(*m));
+
+  // every buffer, the current one is copied out of the
+  // config first so they all look the same
   //
-  if (new == NULL){
-    return;
+  editorBufferStash(&E.buffers[E.curbuf]);
+  for (int i = 0; i < E.numbuffers; i++) {
+    editorMemoryBuffer(m, &E.buffers[i]);
   }
 
-  // copy the string into the current memory
-  // it copies the memory to the last area in
-  // the character array in the appendbuffer
-  //
-  memcpy(&new[ab->len], s, len);
+  // rows on their way through the background highlighter
+  //
+  struct editorHighlighter *w = &E.hlworker;
+  if (w->running) {
+    pthread_mutex_lock(&w->lock);
+    struct editorHighlightJob *lists[3] = {w->urgent, w->jobs, w->done};
+    for (int k = 0; k < 3; k++) {
+      for (struct editorHighlightJob *job = lists[k]; job; job = job->next) {
+        editorMemoryAdd(m, MEM_HIGHLIGHTER, sizeof(*job));
+        if (job->render) {
+          editorMemoryAdd(m, MEM_HIGHLIGHTER, job->rsize);
+        }
+        if (job->hl) {
+          editorMemoryAdd(m, MEM_HIGHLIGHTER, job->rsize);
+        }
+      }
+    }
+    pthread_mutex_unlock(&w->lock);
+  }
 
-  // set the character array to the new string
+  // the line index of the viewer, the file itself is
+  // mapped and not counted
   //
-  ab->b = new;
+  if (E.view.active) {
+    pthread_mutex_lock(&E.view.lock);
+    editorMemoryAdd(m, MEM_VIEW, sizeof(size_t) * E.view.capmarks);
+    pthread_mutex_unlock(&E.view.lock);
+  }
+}
 
-  // increase the length by the length of
-  // the new appended string
-  //
-  ab->len += len;
+size_t editorMemoryTotal(struct editorMemory *m) {
+  size_t total = 0;
+  for (int k = 0; k < MEM_KINDS; k++) {
+    total += m->bytes[k];
+  }
+  return total;
 }
 
-void abFree(struct abuf *ab) {
+int editorMemoryFormat(char *buf, int size, size_t bytes) {
 
-  // free the string from the stack
+  // three digits at most and a unit
   //
-  free(ab->b);
+  if (bytes < 1024) {
+    return snprintf(buf, size, "%zu", bytes);
+  }
+  const char *units = "KMGT";
+  double v = bytes / 1024.0;
+  int u = 0;
+  while (v >= 1024 && u < 3) {
+    v /= 1024;
+    u++;
+  }
+  return snprintf(buf, size, "%.*f%c", v < 10 ? 1 : 0, v, units[u]);
+}
 
+int editorMemoryLine(char *buf, int size) {
+
+  // bytes and blocks of every kind in use and how
+  // many times the file size it all comes to, this
+  // walks every row so the line is kept for a while
+  // and every frame in between shows it again
+  //
+  long long now = editorStatsClock();
+  if (E.stats.memtime == 0 || now - E.stats.memtime >= KILO_MEMORY_REFRESH * 1000000LL) {
+    struct editorMemory m;
+    editorMemoryCount(&m);
+    char total[16];
+    editorMemoryFormat(total, sizeof(total), editorMemoryTotal(&m));
+    int max = sizeof(E.stats.memline);
+    int len = snprintf(E.stats.memline, max, "mem %s x%.1f", total, m.filesize ? (double)editorMemoryTotal(&m) / m.filesize : 0.0);
+    for (int k = 0; k < MEM_KINDS && len < max; k++) {
+      if (m.allocs[k] == 0) {
+        continue;
+      }
+      char bytes[16];
+      editorMemoryFormat(bytes, sizeof(bytes), m.bytes[k]);
+      len += snprintf(E.stats.memline + len, max - len, " %s %s/%zu", editorMemoryNames[k], bytes, m.allocs[k]);
+    }
+    E.stats.memlen = len < max ? len : max - 1;
+    E.stats.memtime = now;
+  }
+  int len = E.stats.memlen < size ? E.stats.memlen : size - 1;
+  memcpy(buf, E.stats.memline, len);
+  buf[len] = '\0';
+  return len;
 }
 
-/* End Append Buffer */
+void editorMemoryReport(FILE *fp) {
 
+  // a line for every kind in use and the total against
+  // the size of the files
+  //
+  struct editorMemory m;
+  editorMemoryCount(&m);
+  for (int k = 0; k < MEM_KINDS; k++) {
+    if (m.allocs[k]) {
+      fprintf(fp, "memory %-12s %12zu bytes %10zu blocks\n", editorMemoryNames[k], m.bytes[k], m.allocs[k]);
+    }
+  }
+  size_t total = editorMemoryTotal(&m);
+  fprintf(fp, "memory %-12s %12zu bytes %10.2f x file of %zu bytes\n", "total", total,
+    m.filesize ? (double)total / m.filesize : 0.0, m.filesize);
+}
 
+/* End Memory Accounting */
 
-/* Text Actions */
 
-void editorUpdateRow(erow *row) {
 
-  // integer to keep count for number
-  // of tabs
-  //
-  int tabs = 0;
+/* Key Traces */
 
-  // index integer
-  //
-  int j;
+int editorTraceRecord(char *filename) {
 
-  // iterate through row and count the number
-  // of tabs
+  // every key read from here on goes into the file
   //
-  for (j = 0; j < row->size; j++) {
-    if (row->chars[j] == '\t') {
-      tabs++;
-    }
+  E.trace.record = fopen(filename, "w");
+  if (!E.trace.record) {
+    return -1;
   }
-  // release the memory from the previous render
-  //
-  free(row->render);
-  
-  // allocate memory the size of the row render
-  // plus the number of tabs
-  //
-  row->render = malloc(row->size + tabs*(KILO_TAB_STOP - 1) + 1);
+  E.trace.start = editorStatsClock();
+  fprintf(E.trace.record, "kilo-trace 1\n");
+  return 0;
+}
 
-  // external integer with different scope
-  //
-  int idx = 0;
+void editorTraceWrite(int c, long long now) {
 
-  // iterate through the row
+  // microseconds into the session and the key, flushed
+  // right away so a crash keeps the keys that led to it
   //
-  for (j = 0; j < row->size; j++) {
-
-    // If it is a tab
-    //
-    if (row->chars[j] == '\t') {
+  fprintf(E.trace.record, "%lld %d\n", (now - E.trace.start) / 1000, c);
+  fflush(E.trace.record);
+}
 
-      // add spaces up to 8
-      //
-      row->render[idx++] = ' ';
-      while (idx % KILO_TAB_STOP != 0) {
-        row->render[idx++] = ' ';
-      }
-    } 
-    else {
+int editorTraceLoad(char *filename) {
+  FILE *fp = fopen(filename, "r");
+  if (!fp) {
+    return -1;
+  }
+  int version;
+  if (fscanf(fp, "kilo-trace %d", &version) != 1 || version != 1) {
+    fclose(fp);
+    errno = EINVAL;
+    return -1;
+  }
 
-      // increase the render size
-      // and set it equal to the character
-      //
-      row->render[idx++] = row->chars[j];
+  // the keys are played as fast as the editor takes
+  // them, the times are only there for reading
+  //
+  long long usec;
+  int c;
+  int cap = 0;
+  while (fscanf(fp, "%lld %d", &usec, &c) == 2) {
+    if (E.trace.nkeys == cap) {
+      cap = cap ? cap * 2 : 1024;
+      E.trace.keys = realloc(E.trace.keys, sizeof(int) * cap);
     }
+    E.trace.keys[E.trace.nkeys++] = c;
   }
+  fclose(fp);
 
-  // set the null terminating character
-  // at the end of the row
-  // and change the size of the render
+  // on a screen in memory
   //
-  row->render[idx] = '\0';
-  row->rsize = idx;
+  editorHeadlessStart(NULL, 0, KILO_HEADLESS_ROWS, KILO_HEADLESS_COLS);
+  E.trace.replay = 1;
+  return 0;
+}
 
-  // update syntax highlighting
+int editorTraceNext() {
+
+  // an exhausted trace reads as escapes like
+  // an exhausted script
   //
-  editorUpdateSyntax(row);
+  editorHeadlessKey();
+  return E.trace.pos < E.trace.nkeys ? E.trace.keys[E.trace.pos++] : '\x1b';
 }
 
-void editorInsertRow(int at, char *s, size_t len) {
-  
-  // check to see if it is a valid row
-  //
-  if (at < 0 || at > E.numrows) {
-    return;
-  } 
+/* End Key Traces */
 
-  // allocate memory to the row
-  //
-  E.row = realloc(E.row, sizeof(erow) * (E.numrows + 1));
 
-  // move the memory of the row to be inserted
-  //
-  memmove(&E.row[at + 1], &E.row[at], sizeof(erow) * (E.numrows - at));
 
-  // update the index of each row
-  for (int j = at + 1; j <= E.numrows; j++) {
-    E.row[j].idx++;
-  }
+/* Set Bottom Bar Information */
 
-  // have the current row index update
-  //
-  E.row[at].idx = at;
+// ... makes a variadic function
+// means it can take any number of arguments
+//
+void editorSetStatusMessage(const char *fmt, ...) {
 
-  // allocate memory to the correct size of rows
+  // intialize the variable this will be
+  // like a %d but take the string
+  // we give it
   //
-  E.row = realloc(E.row, sizeof(erow) * (E.numrows + 1));
+  va_list ap;
 
-  // set the size of the row to the length of the string
+  // sets the variable list to the characters
+  // in the message
   //
-  E.row[at].size = len;
+  va_start(ap, fmt);
 
-  // allocate memory while compensating for the null
-  // terminating characer
+  // set the status message to the help message in a formatted
+  // way where we print he status 
   //
-  E.row[at].chars = malloc(len + 1);
+  vsnprintf(E.statusmsg, sizeof(E.statusmsg), fmt, ap);
+
+  // cleans up memory associated
+  // 
+  va_end(ap);
 
-  // copy the string into the row
+  // get the time
   //
-  memcpy(E.row[at].chars, s, len);
+  E.statusmsg_time = time(NULL);
+  editorEventsTimer();
+}
 
-  // set the last character to a null terminating character
-  E.row[at].chars[len] = '\0';
+void editorDrawStatusBar(struct abuf *ab) {
 
-  // set render information
-  // and highlight information
-  // set default comment info
+  // move below the text area and
+  // switch to inverted colors
   //
-  E.row[at].rsize = 0;
-  E.row[at].render = NULL;
-  E.row[at].hl = NULL;
-  E.row[at].hl_open_comment = 0;
-  editorUpdateRow(&E.row[at]);
+  char pos[32];
+  int poslen = snprintf(pos, sizeof(pos), "\x1b[%d;1H", E.termrows + 1);
+  abAppend(ab, pos, poslen);
+  abAppend(ab, "\x1b[7m", 4);
   
-  // set the number of rows to 0
-  //
-  E.numrows++;
-
-  // modification tracking
+  // set a character array to hold the message
+  // and a character array for the current line number
   //
-  E.dirty++;
-}
-
-void editorRowInsertChar(erow *row, int at, int c) {
+  char status[256], rstatus[80];
 
-  // checks for line ending and beginnings
-  // and compensates by putting the cursor at
-  // the end of the row
+  // get how many characters would be needed to print the message
+  // and load it into the character array
   //
-  if (at < 0 || at > row->size) {
-    at = row->size;
+  int len;
+  size_t lines = 0;
+  int scanning = 0;
+  if (E.view.active) {
+    pthread_mutex_lock(&E.view.lock);
+    lines = E.view.lines;
+    scanning = !E.view.done;
+    pthread_mutex_unlock(&E.view.lock);
+  }
+  if (E.stats.show == 1) {
+    len = editorStatsLine(status, sizeof(status));
+  }
+  else if (E.stats.show == 2) {
+    len = editorMemoryLine(status, sizeof(status));
+  }
+  else if (E.view.active) {
+    len = snprintf(status, sizeof(status), "%.20s - %zu%s lines [view]", E.filename, lines, scanning ? "+" : "");
+  }
+  else if (E.numbuffers > 1) {
+    len = snprintf(status, sizeof(status), "[%d/%d] %.20s - %d lines %s", E.curbuf + 1, E.numbuffers, E.filename ? E.filename : "[No Name]", E.numrows, editorIsDirty() ? "(modified)" : "");
+  }
+  else {
+    len = snprintf(status, sizeof(status), "%.20s - %d lines %s", E.filename ? E.filename : "[No Name]", E.numrows, editorIsDirty() ? "(modified)" : "");
   }
 
-  // allocate room for the inserted character
+  // get how manay characters would be needed and write the message
+  // into the character array
   //
-  row->chars = realloc(row->chars, row->size + 2);
+  int rlen;
+  if (E.view.active) {
+    rlen = snprintf(rstatus, sizeof(rstatus), "%s | %zu/%zu%s", E.syntax ? E.syntax->filetype : "no ft", E.view.base + E.cy + 1, lines, scanning ? "+" : "");
+  }
+  else {
+    rlen = snprintf(rstatus, sizeof(rstatus), "%s | %d/%d", E.syntax ? E.syntax->filetype : "no ft", E.cy + 1, E.numrows);
+  }
 
-  // copy the string of all the characters before with an extra gap
+  // compensate if message is longer than screen length
   //
-  memmove(&row->chars[at + 1], &row->chars[at], row->size - at + 1);
+  if (len > E.termcols) {
+    len = E.termcols;
+  }
 
-  // increase the size of the row
+  // write the message
   //
-  row->size++;
+  abAppend(ab, status, len);
 
-  // set the spare gap to a character
+  // set the row to be of spaces with a white
+  // background and keep track of how long the row is
   //
-  row->chars[at] = c;
+  while (len < E.termcols) {
+    if (E.termcols - len == rlen) {
+      abAppend(ab, rstatus, rlen);
+      break;
+    }
+    else{
+      abAppend(ab, " ", 1);
+      len++;
+    }
+  }
 
-  // update the row
+  // switch to original colors
   //
-  editorUpdateRow(row);
-
+  abAppend(ab, "\x1b[m", 3);
 
-  // modification tracking
+  // print a new line after the status message
   //
-  E.dirty++;
+  abAppend(ab, "\r\n", 2);
 }
 
-void editorInsertChar(int c) {
-
-  // if at the end of the file
+void editorDrawRows(struct abuf *ab) {
+  
+  // number to keep track of which row 
+  // the loop is on
   //
-  if (E.cy == E.numrows) {
+  int y;
 
-    // append a new blank row
+  // find the file row and the wrapped segment of it
+  // that sits at the top of the screen
+  //
+  int sub = 0;
+  int filerow = editorLayoutRowOfLine(E.rowoff, &sub);
+  
+  // loop through the rows of the screen
+  // and write a tilda at the beginning of each line
+  //
+  for (y = 0; y < E.screenrows; y++) {
+
+    // move to the start of the line within the pane
     //
-    editorInsertRow(E.numrows, "", 0);
-  }
+    char pos[32];
+    int poslen = snprintf(pos, sizeof(pos), "\x1b[%d;%dH", E.screentop + y + 1, E.screenleft + 1);
+    abAppend(ab, pos, poslen);
 
-  // insert a character into the row
-  //
-  editorRowInsertChar(&E.row[E.cy], E.cx, c);
+    // number of columns the line has filled
+    //
+    int used = 0;
 
-  // increase cursor position by 1
-  //
-  E.cx++;
-}
+    // check if user is outside of the file 
+    //
+    if (filerow >= E.numrows) {
+      
+      // if we are 1/3 the way down the screen
+      // and the number of rows is 0
+      //
+      if (E.numrows == 0 && y == E.screenrows / 3) {
+          
+        // print out a welcome message
+        //
+        char welcome[80];
 
-void editorRowAppendString(erow *row, char *s, size_t len) {
+        // return how many characters would have been written
+        // if the buffer was the right size
+        //
+        int welcomelen = snprintf(welcome, sizeof(welcome), "Text editor -- version %s", KILO_VERSION);
 
-  // add memory equivalent to the amount of data needed
-  // to be added to the row
-  //
-  row->chars = realloc(row->chars, row->size + len + 1);
+        // adjust the size of the buffer and write it
+        //
+        if (welcomelen > E.screencols) {
+          welcomelen = E.screencols;
+        }
 
-  // copy the string to the end of the row
-  //
-  memcpy(&row->chars[row->size], s, len);
+        // find half way through the screen
+        //
+        int padding = (E.screencols - welcomelen) / 2;
 
-  // increase the size of the row
-  //
-  row->size += len;
+        // if padding exists
+        //
+        if (padding) {
 
-  // add a null terminating character
-  //
-  row->chars[row->size] = '\0';
+          // append a tilda at the start of the line
+          // and compensate in the padding
+          //
+          abAppend(ab, "~", 1);
+          padding--;
+        
+        }
 
-  // update the row
-  //
-  editorUpdateRow(row);
+        // print spaces until padding is 0
+        //
+        while (padding--) {
+          abAppend(ab, " ", 1);
+        }
 
-  // increment the modification counter
-  //
-  E.dirty++;
+        // write the message
+        //
+        abAppend(ab, welcome, welcomelen);
+        used = (E.screencols - welcomelen) / 2 + welcomelen;
+
+      } 
+      
+      else {
+
+        // add a tilda to the beginning of the line
+        // 
+        abAppend(ab,"~",1);
+        used = 1;
+
+      }
+    }
+
+    else if (E.wrap) {
+
+      // index the row
+      //
+      erow *row = &E.row[filerow];
+
+      // draw the part of the row that falls
+      // on this visual line
+      //
+      int width = editorWrapWidth();
+      int start = sub * width;
+      int len = row->rsize - start;
+      if (len < 0) {
+        len = 0;
+      }
+      if (len > width) {
+        len = width;
+      }
+      editorDrawRowSegment(ab, row, start, len);
+      used = len;
+
+      // move on to the next row once every
+      // segment of this one has been drawn,
+      // past the rows folded under it
+      //
+      if (++sub >= editorRowHeight(row)) {
+        used += editorDrawFoldMarker(ab, filerow, E.screencols - used);
+        filerow = editorFoldNext(filerow + 1);
+        sub = 0;
+      }
+    }
+
+    else {
+
+      // set length to the row size while 
+      // compensating with the offset of the column
+      //
+      int len = E.row[filerow].rsize - E.coloff;
+
+      // If that number is negative reset it 
+      // to the beginning of the column
+      //
+      if (len < 0){
+        len = 0;
+      }
+
+
+      // if the len is greater than a full row
+      // set the length to the maximum size
+      // of a row
+      //
+      if (len > E.screencols) {
+        len = E.screencols;
+      }
+
+      // draw the visible part of the row
+      //
+      editorDrawRowSegment(ab, &E.row[filerow], E.coloff, len);
+      used = len;
+      used += editorDrawFoldMarker(ab, filerow, E.screencols - used);
+      filerow = editorFoldNext(filerow + 1);
+    }
+
+    // deletes the rest of the line when the pane reaches the
+    // right edge, otherwise pad it so the pane beside it
+    // is left alone
+    //
+    if (E.screenleft + E.screencols >= E.termcols) {
+      abAppend(ab, "\x1b[K", 3);
+    }
+    else {
+      while (used++ < E.screencols) {
+        abAppend(ab, " ", 1);
+      }
+    }
+  }
 }
 
-int editorRowCxToRx(erow *row, int cx) {
+void editorDrawRowSegment(struct abuf *ab, erow *row, int start, int len) {
 
-  // calculate position variable
+  // set a pointer to the character array
   //
-  int rx = 0;
-  
-  // index variable
+  editorRowFill(row);
+  char *c = &row->render[start];
+
+  // set a pointer to the syntax array
+  // with the structure of the row drawn over it
   //
-  int j;
+  unsigned char *hl = &editorParseOverlay(row)[start];
 
-  // loop through all characters
+  // column of the bracket matching the one at the cursor
   //
-  for (j = 0; j < cx; j++) {
+  int match = (row->idx == E.bracket_row) ? E.bracket_col - start : -1;
 
-    // if the character is a tab, set it to the
-    // appropriate amount of spaces
-    // and increment rx accordingly
-    //
-    if (row->chars[j] == '\t')
-      rx += (KILO_TAB_STOP - 1) - (rx % KILO_TAB_STOP);
-    rx++;
+  // columns that are selected
+  //
+  int sel_from = 0, sel_to = 0, inverse = 0;
+  if (editorSelectionColumns(row, &sel_from, &sel_to)) {
+    sel_from -= start;
+    sel_to -= start;
   }
 
-  // return the row variable
+  // keep track of current color
   //
-  return rx;
-}
+  int current_color = -1;
 
-int editorRowRxToCx(erow *row, int rx) {
-  
-  // keep track of absolute cursor position
-  // and relative cursor position
+  // index integer
   //
-  int cur_rx = 0;
-  int cx;
+  int j;
 
   // iterate through the row
   //
-  for (cx = 0; cx < row->size; cx++) {
+  for (j = 0; j < len; j++) {
 
-    // if tab is found convert from absolute spacing
-    // to relative spacing
+    // selected text is drawn inverted
     //
-    if (row->chars[cx] == '\t')
-      cur_rx += (KILO_TAB_STOP - 1) - (cur_rx % KILO_TAB_STOP);
-    cur_rx++;
-
-    if (cur_rx > rx) {
-      return cx;
+    if ((j >= sel_from && j < sel_to) != inverse) {
+      inverse = !inverse;
+      abAppend(ab, inverse ? "\x1b[7m" : "\x1b[27m", inverse ? 4 : 5);
     }
-  }
-  return cx;
-}
+    
+    // if it is a nonprintable character
+    // print out an inverted question mark
+    if (iscntrl(c[j])) {
 
-// free up the memory of the row
-//
-void editorFreeRow(erow *row) {
-  free(row->render);
-  free(row->chars);
-  free(row->hl);
-}
+      char sym = '?';
+      abAppend(ab, "\x1b[7m", 4);
+      abAppend(ab, &sym, 1);
+      abAppend(ab, "\x1b[m", 3);
 
-void editorDelRow(int at) {
+      // return to normal
+      //
+      if (current_color != -1) {
+        char buf[16];
+        int clen = snprintf(buf, sizeof(buf), "\x1b[%dm", current_color);
+        abAppend(ab, buf, clen);
+      }
+      if (inverse) {
+        abAppend(ab, "\x1b[7m", 4);
+      }
+
+    }
+    
+    // append normal character
+    //
+    else if (hl[j] == HL_NORMAL && j != match) {
+      if (current_color != -1) {
+        abAppend(ab, "\x1b[39m", 5);
+        current_color = -1;
+      }
+      abAppend(ab, &c[j], 1);
+    }
+    
+    // otherwise make it the appropriate color
+    //
+    else {
+      int color = editorSyntaxToColor(j == match ? HL_MATCH : hl[j]);
+      if (color != current_color) {
+        current_color = color;
+        char buf[16];
+        int clen = snprintf(buf, sizeof(buf), "\x1b[%dm", color);
+        abAppend(ab, buf, clen);
+      }
+      abAppend(ab, &c[j], 1);
+    }
+  } 
 
-  // check to see if valid row to delete
+  // return to normal
   //
-  if (at < 0 || at >= E.numrows) {
-    return;
+  if (inverse) {
+    abAppend(ab, "\x1b[27m", 5);
   }
+  abAppend(ab, "\x1b[39m", 5);
+}
 
-  // Free the memory of the row
+void editorDrawMessageBar(struct abuf *ab) {
+
+  // clear message bar
   //
-  editorFreeRow(&E.row[at]);
+  abAppend(ab, "\x1b[K", 3);
 
-  // move the memory of the rows after
-  // to fill the new blank space
+  // find the length of the status message
   //
-  memmove(&E.row[at], &E.row[at + 1], sizeof(erow) * (E.numrows - at - 1));
+  int msglen = strlen(E.statusmsg);
 
-  // update the index of each row after one is deleted
+  // if it is longer than the screen
+  // compensate for that
   //
-  for (int j = at; j < E.numrows - 1; j++) {
-    E.row[j].idx--;
+  if (msglen > E.termcols) {
+    msglen = E.termcols;
   }
 
-  // decrement the number of rows
-  // and incriment the modification counter
+  // if it has been less than 5 secs, display
+  // the message
   //
-  E.numrows--;
-  E.dirty++;
+  if (msglen && time(NULL) - E.statusmsg_time < 5)
+    abAppend(ab, E.statusmsg, msglen);
 }
 
-void editorRowDelChar(erow *row, int at) {
+/* End Set Bottom Bar Information */
 
-  // Check if valid index size
-  //
-  if (at < 0 || at >= row->size) {
-    return;
-  }
 
-  // Perform the delete
-  //
-  memmove(&row->chars[at], &row->chars[at + 1], row->size - at);
 
-  // Decrement Row Size
-  //
-  row->size--;
+/* Error Handling */
+
+void die(const char *s) {
   
-  // update the row
+  // clear the screen
   //
-  editorUpdateRow(row);
-  
-  // increment modification coutner
+  E.term->write("\x1b[2J", 4);
+  E.term->write("\x1b[H", 3);
+
+  // perror prints an error message
   //
-  E.dirty++;
+  perror(s);
 
+  // Exit the program
+  //
+  exit(1);
 }
 
-void editorDelChar() {
+/* End Error Handling */
 
-  // check to see if at the end of the file
-  //
-  if ((E.cy >= E.numrows) || (E.cx == 0 && E.cy == 0)){
-    return;
-  }
 
 
-  // index the row
-  //
-  erow *row = &E.row[E.cy];
+/* Append Buffer */
 
-  // Make sure that the cursor is within the row
-  //
-  if (E.cx > 0) {
+void abAppend(struct abuf *ab, const char *s, int len) {
 
-    // delete the character to the left
-    //
-    editorRowDelChar(row, E.cx - 1);
+  // add extra length to the buffer
+  //
+  char *new = realloc(ab->b, ab->len + len);
 
-    // decrement the row
-    //
-    E.cx--;
+  // if failed return
+  //
+  if (new == NULL){
+    return;
   }
 
-  else {
-
-    // set cursor position to the end of the previous line
-    //
-    E.cx = E.row[E.cy - 1].size;
-
-    // Append the row below to the current row
-    //
-    editorRowAppendString(&E.row[E.cy - 1], row->chars, row->size);
+  // copy the string into the current memory
+  // it copies the memory to the last area in
+  // the character array in the appendbuffer
+  //
+  memcpy(&new[ab->len], s, len);
 
-    // Delete the row below
-    //
-    editorDelRow(E.cy);
-    
-    // decrement the cursor y position
-    //
-    E.cy--;
-  }
+  // set the character array to the new string
+  //
+  ab->b = new;
 
+  // increase the length by the length of
+  // the new appended string
+  //
+  ab->len += len;
 }
 
-void editorInsertNewline() {
+void abFree(struct abuf *ab) {
 
-  // if at the beginning of a line
-  // insert a blank line
+  // free the string from the stack
   //
-  if (E.cx == 0) {
-    editorInsertRow(E.cy, "", 0);
-  } 
-  else {
-    
-    // index the row
-    //
-    erow *row = &E.row[E.cy];
+  free(ab->b);
 
-    // insert a row below the current one with the characters 
-    // after the cursor at the current line
-    //
-    editorInsertRow(E.cy + 1, &row->chars[E.cx], row->size - E.cx);
+}
 
-    // index the previous row
-    //
-    row = &E.row[E.cy];
+/* End Append Buffer */
 
-    // update its size
-    // and add a null terminating character
-    //
-    row->size = E.cx;
-    row->chars[row->size] = '\0';
 
-    // update the row
-    //
-    editorUpdateRow(row);
-  }
 
-  // increase the cursor position and set it to the beginning
-  // of the next line
-  //
-  E.cy++;
-  E.cx = 0;
-}
+/* Text Actions */
 
-void editorDeleteRight() {
+void editorUpdateRow(erow *row) {
 
-  // index the row
+  // lay the characters out for the screen
   //
-  erow *row = &E.row[E.cy];
+  editorRowRender(row);
 
-  // check if empty row
+  // this is a new version of the row, highlighting
+  // of the old one is no use anymore
   //
-  if (row->size == 0) {
-    editorDelRow(E.cy);
-    return;
-  }
+  row->hlver = ++E.hlseq;
 
-  // Check if valid index size
+  // hash the new contents, a row that is part of the
+  // buffer already moves the links to its neighbours
   //
-  if (E.cx < 0 || E.cx >= row->size || row->size == 0) {
-    return;
+  uint64_t hash = editorHash64(row->chars, row->size);
+  if (row->hash != 0 && row->hash != hash) {
+    uint64_t prev = row->idx > 0 ? E.row[row->idx - 1].hash : 0;
+    uint64_t next = row->idx + 1 < E.numrows ? E.row[row->idx + 1].hash : 0;
+    E.hashes.link -= editorHashLink(prev, row->hash) + editorHashLink(row->hash, next);
+    E.hashes.link += editorHashLink(prev, hash) + editorHashLink(hash, next);
   }
+  row->hash = hash;
 
-  // Perform the delete
+  // and leave both with the text for rows that share it
   //
-  memmove(&row->chars[E.cx], &row->chars[row->size], 1);
+  TEXT_OF(row->chars)->rsize = row->rsize;
+  TEXT_OF(row->chars)->hash = hash;
 
-  // Decrement Row Size
-  //
-  row->size-=row->size - E.cx;
-  
-  // set the cursor position
+  // update syntax highlighting
   //
-  E.cx = row->size;
+  editorUpdateSyntax(row);
 
-  // update the row
-  //
-    editorUpdateRow(row);
-  
-  // increment modification coutner
+  // lay the row out again in case its
+  // wrapped height changed
   //
-  E.dirty++;
-}
+  editorLayoutUpdateRow(row->idx);
 
-/* End Text Actions */
+}
 
-/* Syntax Actions */
+void editorRowRender(erow *row) {
 
-void editorSelectSyntaxHighlight() {
+  // integer to keep count for number
+  // of tabs
+  //
+  int tabs = 0;
 
-  // reset syntax of row
+  // index integer
   //
-  E.syntax = NULL;
+  int j;
 
-  // if no filename
-  // exit
+  // iterate through row and count the number
+  // of tabs
   //
-  if (E.filename == NULL) {
-    return;
+  for (j = 0; j < row->size; j++) {
+    if (row->chars[j] == '\t') {
+      tabs++;
+    }
   }
-
-  // find the extension
+  // release the memory from the previous render
   //
-  char *ext = strrchr(E.filename, '.');
-
-  // iterate through the highlate database entries
+  free(row->render);
+  
+  // allocate memory the size of the row render
+  // plus the number of tabs
   //
-  for (unsigned int j = 0; j < HLDB_ENTRIES; j++) {
+  row->render = malloc(row->size + tabs*(KILO_TAB_STOP - 1) + 1);
 
-    // index the highlight database
-    //
-    struct editorSyntax *s = &HLDB[j];
+  // external integer with different scope
+  //
+  int idx = 0;
 
-    // index variable
-    //
-    unsigned int i = 0;
+  // iterate through the row
+  //
+  for (j = 0; j < row->size; j++) {
 
-    // iterate through check for file extensions
+    // If it is a tab
     //
-    while (s->filematch[i]) {
-      int is_ext = (s->filematch[i][0] == '.');
-
-      // if there is an extension check to see if it matches
-      // otherwise check if the extension is in the filename
-      // 
-      if ((is_ext && ext && !strcmp(ext, s->filematch[i])) || (!is_ext && strstr(E.filename, s->filematch[i]))) {
-        
-        // set the correct syntax database
-        //
-        E.syntax = s;
-
-        // loop through the file rows and update the syntax for
-        // each row
-        //
-        int filerow;
-        for (filerow = 0; filerow < E.numrows; filerow++) {
-          editorUpdateSyntax(&E.row[filerow]);
-        }
+    if (row->chars[j] == '\t') {
 
-        return;
+      // add spaces up to 8
+      //
+      row->render[idx++] = ' ';
+      while (idx % KILO_TAB_STOP != 0) {
+        row->render[idx++] = ' ';
       }
+    } 
+    else {
 
-      // increment the variable
+      // increase the render size
+      // and set it equal to the character
       //
-      i++;
+      row->render[idx++] = row->chars[j];
     }
   }
+
+  // set the null terminating character
+  // at the end of the row
+  // and change the size of the render
+  //
+  row->render[idx] = '\0';
+  row->rsize = idx;
 }
 
-int is_separator(int c) {
+void editorRowFill(erow *row) {
 
-  // check if it is a separator 
+  // a row pasted from text that was laid out before
+  // is rendered the first time something looks at it,
+  // plain until the highlighter gets to it
   //
-  return isspace(c) || c == '\0' || strchr(",.()+-/*=~%<>[];", c) != NULL;
+  if (row->render != NULL) {
+    return;
+  }
+  editorRowRender(row);
+  row->hl = realloc(row->hl, row->rsize);
+  memset(row->hl, HL_NORMAL, row->rsize);
+  editorParseClear(row);
+  editorBracketUpdateRow(row);
 }
 
-void editorUpdateSyntax(erow *row) {
+void editorInsertRow(int at, char *s, size_t len) {
+  
+  // check to see if it is a valid row
+  //
+  if (at < 0 || at > E.numrows) {
+    return;
+  } 
 
-  // allocate memory for the row highlights
+  // allocate memory to the row
   //
-  row->hl = realloc(row->hl, row->rsize);
+  E.row = realloc(E.row, sizeof(erow) * (E.numrows + 1));
 
-  // set the whole row to normal
+  // move the memory of the row to be inserted
   //
-  memset(row->hl, HL_NORMAL, row->rsize);
+  memmove(&E.row[at + 1], &E.row[at], sizeof(erow) * (E.numrows - at));
 
-  // if there is no syntax in the row
-  // return
+  // update the index of each row, rows that moved while
+  // on their way to the highlighter come back under their
+  // old index and are thrown away, so they are no longer
+  // on their way
   //
-  if (E.syntax == NULL) {
-   return;
+  for (int j = at + 1; j <= E.numrows; j++) {
+    E.row[j].idx++;
+    E.row[j].hl_queued = 0;
   }
 
-  // load in keywords
+  // have the current row index update
   //
-  char **keywords = E.syntax->keywords;
+  E.row[at].idx = at;
 
-  // keep track of single line comment start
+  // make room for the row in the wrap layout
+  // and look at the rows from here down again
   //
-  char *scs = E.syntax->singleline_comment_start;
+  editorFoldInsertRows(at, 1);
+  editorLayoutInsertRows(at, 1);
+  editorHighlightInvalidate(at);
+  editorBracketInvalidate(at);
 
-  // multiline comments start and end
+  // every row from here down moved down
   //
-  char *mcs = E.syntax->multiline_comment_start;
-  char *mce = E.syntax->multiline_comment_end;
+  editorPanesTouch(at, INT_MAX);
 
-  // length of single line comment
+  // fill the row in
   //
-  int scs_len = scs ? strlen(scs) : 0;
+  editorRowInit(at, s, len);
   
-  // length of multiline comments
+  // set the number of rows to 0
+  // and link it in between its neighbours
   //
-  int mcs_len = mcs ? strlen(mcs) : 0;
-  int mce_len = mce ? strlen(mce) : 0;
+  E.numrows++;
+  editorHashInsertRow(at);
 
-  // keep track of separator characters
-  //
-  int prev_sep = 1;
-  
-  // keep track of if we are in a string
+  // the row below now starts where this one ends
   //
-  int in_string = 0;
-  
-  // keep track of if we are in a ml comment
+  if (at + 1 < E.numrows) {
+    editorParseRows(&E.row[at + 1], 0);
+  }
+
+  // modification tracking
   //
-  int in_comment = (row->idx > 0 && E.row[row->idx - 1].hl_open_comment);
+  E.dirty++;
+}
 
-  // index variable
+void editorRowInit(int at, char *s, size_t len) {
+
+  // the row gets a copy of the string
   //
-  int i = 0;
+  editorRowInitText(at, editorTextAlloc(s, len), len);
+}
 
-  // iterate through the whole row
+void editorRowInitText(int at, char *text, size_t len) {
+
+  // set the size of the row to the length of the string
+  // and take over the text, the character after the last
+  // one has to be a null terminating character
   //
-  while (i < row->rsize) {
+  E.row[at].size = len;
+  E.row[at].chars = text;
 
-    // load in the specific character
-    //
-    char c = row->render[i];
-    
-    // previous character
-    //
-    unsigned char prev_hl = (i > 0) ? row->hl[i - 1] : HL_NORMAL;
-
-    // if this is a single line comment
-    //
-    if (scs_len && !in_string && !in_comment) {
+  // set render information
+  // and highlight information
+  // set default comment info
+  //
+  E.row[at].rsize = 0;
+  E.row[at].render = NULL;
+  E.row[at].hl = NULL;
+  E.row[at].hl_open_comment = 0;
+  E.row[at].hlver = 0;
+  E.row[at].hl_done = 0;
+  E.row[at].hl_queued = 0;
+  E.row[at].nodes = NULL;
+  E.row[at].nnodes = 0;
+  E.row[at].defs = NULL;
+  E.row[at].ndefs = 0;
+  E.row[at].ps_in = 0;
+  E.row[at].ps_out = 0;
+  memset(&E.row[at].br, 0, sizeof(struct editorBracketSum));
+  E.row[at].hash = 0;
+
+  // text some row already worked out only needs its
+  // size and hash until the row is looked at, as long
+  // as the highlighter colors it whenever that is
+  //
+  struct editorText *t = TEXT_OF(text);
+  if (t->rsize >= 0 && (E.syntax == NULL || E.hlworker.running || E.hl_hold)) {
+    E.row[at].rsize = t->rsize;
+    E.row[at].hash = t->hash;
+    E.row[at].hlver = ++E.hlseq;
+    editorLayoutUpdateRow(at);
+    return;
+  }
+  editorUpdateRow(&E.row[at]);
+}
 
-      // if thi is not the beginning of the row
-      //
-      if (!strncmp(&row->render[i], scs, scs_len)) {
-        memset(&row->hl[i], HL_COMMENT, row->rsize - i);
-        break;
-      }
-    }
+void editorAppendRows(char *s, size_t len) {
 
-    // if all proper flags are one and we aren't in a string
-    //
-    if (mcs_len && mce_len && !in_string) {
+  // count the rows, a last line without a
+  // newline is a row as well
+  //
+  int n = 0;
+  for (char *p = s; (p = memchr(p, '\n', s + len - p)) != NULL; p++) {
+    n++;
+  }
+  if (len > 0 && s[len - 1] != '\n') {
+    n++;
+  }
+  if (n == 0) {
+    return;
+  }
 
-      // if we are within a comment
-      //
-      if (in_comment) {
+  // make room for all of them at once, nothing moves and
+  // no fold reaches past the end so only the layout
+  // needs to hear about each row
+  //
+  int at = E.numrows;
+  E.row = realloc(E.row, sizeof(erow) * (E.numrows + n));
+  char *p = s;
+  char *end = s + len;
+  while (p < end) {
+    char *nl = memchr(p, '\n', end - p);
+    size_t linelen = (nl ? nl : end) - p;
+    if (linelen > 0 && p[linelen - 1] == '\r') {
+      linelen--;
+    }
+    E.row[E.numrows].idx = E.numrows;
+    editorLayoutInsertRows(E.numrows, 1);
+    editorRowInit(E.numrows, p, linelen);
+    E.numrows++;
+    editorHashInsertRow(E.numrows - 1);
+    p = nl ? nl + 1 : end;
+  }
 
-        // set the character to a multiline comment
-        row->hl[i] = HL_MLCOMMENT;
+  // and look at the new rows once
+  //
+  editorHighlightInvalidate(at);
+  editorBracketInvalidate(at);
+  editorPanesTouch(at, INT_MAX);
+}
 
-        // check if at end of multiline comment
-        //
-        if (!strncmp(&row->render[i], mce, mce_len)) {
+void editorInsertRows(int at, struct editorSlice *lines, int n) {
 
-          // if not highlight the whole comment 
-          //
-          memset(&row->hl[i], HL_MLCOMMENT, mce_len);
-          i += mce_len;
-          in_comment = 0;
-          prev_sep = 1;
-          continue;
-        } 
-        
-        else {
-          i++;
-          continue;
-        }
-      }
+  // check to see if it is a valid row
+  //
+  if (at < 0 || at > E.numrows || n <= 0) {
+    return;
+  }
 
-      // check if we are at the beginning of a comment
-      // 
-      else if (!strncmp(&row->render[i], mcs, mcs_len)) {
+  // make room for all of them and move the rows
+  // below out of the way once
+  //
+  E.row = realloc(E.row, sizeof(erow) * (E.numrows + n));
+  memmove(&E.row[at + n], &E.row[at], sizeof(erow) * (E.numrows - at));
+  for (int j = at + n; j < E.numrows + n; j++) {
+    E.row[j].idx += n;
+    E.row[j].hl_queued = 0;
+  }
 
-        // if so set the comment to the appropriate color
-        //
-        memset(&row->hl[i], HL_MLCOMMENT, mcs_len);
-        i += mcs_len;
-        in_comment = 1;
-        continue;
+  // the new rows start out empty and part of the buffer,
+  // nothing is left of the rows that moved out of the way
+  //
+  memset(&E.row[at], 0, sizeof(erow) * n);
+  for (int k = 0; k < n; k++) {
+    E.row[at + k].idx = at + k;
+  }
+  uint64_t next = at < E.numrows ? E.row[at + n].hash : 0;
+  E.numrows += n;
+  editorFoldInsertRows(at, n);
+  editorLayoutInsertRows(at, n);
+  editorHighlightInvalidate(at);
+  editorBracketInvalidate(at);
+  editorPanesTouch(at, INT_MAX);
+
+  // a whole row of text is shared with the row it came from,
+  // a piece of one is copied, every row stays plain until
+  // they are all in
+  //
+  uint64_t prev = at > 0 ? E.row[at - 1].hash : 0;
+  E.hashes.link -= editorHashLink(prev, next);
+  int hold = E.hl_hold;
+  E.hl_hold = 1;
+  for (int k = 0; k < n; k++) {
+    struct editorSlice *l = &lines[k];
+    if (l->shared) {
+      editorRowInitText(at + k, editorTextRetain(l->text), l->len);
+    }
+    else {
+      editorRowInit(at + k, l->text + l->off, l->len);
+    }
+    E.hashes.link += editorHashLink(prev, E.row[at + k].hash);
+    prev = E.row[at + k].hash;
+  }
+  E.hl_hold = hold;
+  E.hashes.link += editorHashLink(prev, next);
+
+  // then color them and the row after them, the background
+  // highlighter gets to them by itself, otherwise each row
+  // that does not start in the state the row above ends in
+  // is done here and carries a change of state on down
+  //
+  if (E.syntax && !E.hlworker.running && !E.hl_hold) {
+    for (int k = at; k <= at + n && k < E.numrows; k++) {
+      int in = (k > 0 && E.row[k - 1].hl_open_comment);
+      if (E.row[k].hl_done != HL_KEY(E.row[k].hlver, in)) {
+        editorUpdateSyntax(&E.row[k]);
       }
     }
+  }
 
-    // if the syntax flag is on highlihgt strings
-    //
-    if (E.syntax->flags & HL_HIGHLIGHT_STRINGS) {
-
-      // if currently in a string
-      //
-      if (in_string) {
+  // the row below now starts where the last one ends
+  //
+  if (at + n < E.numrows) {
+    editorParseRows(&E.row[at + n], 0);
+  }
+  E.dirty++;
+}
 
-        // highlight the character
-        //
-        row->hl[i] = HL_STRING;
+char *editorTextAlloc(const char *s, size_t len) {
 
-        // if character is the closing quote
-        // note exit string
-        //
-        if (c == in_string) {
-          in_string = 0;
-        }
+  // new text held once
+  //
+  struct editorText *t = malloc(sizeof(struct editorText) + len + 1);
+  t->refs = 1;
+  t->rsize = -1;
+  memcpy(t->chars, s, len);
+  t->chars[len] = '\0';
+  return t->chars;
+}
 
-        // increment
-        //
-        i++;
+char *editorTextRetain(char *chars) {
+  TEXT_OF(chars)->refs++;
+  return chars;
+}
 
-        // note that this is a separation character
-        prev_sep = 1;
-        continue;
-      } 
+void editorTextRelease(char *chars) {
 
-      // if is single or double quote
-      //
-      else {
-        if (c == '"' || c == '\'') {
+  // the last one to let go frees it
+  //
+  if (chars && --TEXT_OF(chars)->refs == 0) {
+    free(TEXT_OF(chars));
+  }
+}
 
-          // set the end quote
-          //
-          in_string = c;
+void editorRowReserve(erow *row, size_t extra) {
 
-          // highlihgt as part of string
-          //
-          row->hl[i] = HL_STRING;
+  // the row is about to change, if its text is shared it
+  // gets a copy of its own first, then room for extra
+  // more characters
+  //
+  struct editorText *t = TEXT_OF(row->chars);
+  if (t->refs > 1) {
+    struct editorText *own = malloc(sizeof(struct editorText) + row->size + extra + 1);
+    own->refs = 1;
+    memcpy(own->chars, row->chars, row->size + 1);
+    t->refs--;
+    t = own;
+  }
+  else if (extra > 0) {
+    t = realloc(t, sizeof(struct editorText) + row->size + extra + 1);
+  }
+  t->rsize = -1;
+  row->chars = t->chars;
+}
 
-          // incremenet
-          //
-          i++;
-          continue;
-        }
-      }
-    }
-    
-    // if the syntax flag is on and highlighting numbers flag is on
-    //
-    if (E.syntax->flags & HL_HIGHLIGHT_NUMBERS) {
+void editorRowInsertString(erow *row, int at, const char *s, size_t len) {
 
-      // if it is a number/. and the previous HL is a number, separator, period
-      //
-      if ((isdigit(c) && (prev_sep || prev_hl == HL_NUMBER)) || (c == '.' && prev_hl == HL_NUMBER)) {
+  // put the string in at the position, the rest of
+  // the row moves over once
+  //
+  editorRowReserve(row, len);
+  memmove(&row->chars[at + len], &row->chars[at], row->size - at + 1);
+  memcpy(&row->chars[at], s, len);
+  row->size += len;
+  editorUpdateRow(row);
+  E.dirty++;
+}
 
-        // make the current character a number
-        //
-        row->hl[i] = HL_NUMBER;
+void editorRowInsertChar(erow *row, int at, int c) {
 
-        // incriment i
-        //
-        i++;
+  // checks for line ending and beginnings
+  // and compensates by putting the cursor at
+  // the end of the row
+  //
+  if (at < 0 || at > row->size) {
+    at = row->size;
+  }
 
-        // reset separator
-        //
-        prev_sep = 0;
-        continue;
-      }
-    }
+  // allocate room for the inserted character
+  //
+  editorRowReserve(row, 1);
 
+  // copy the string of all the characters before with an extra gap
+  //
+  memmove(&row->chars[at + 1], &row->chars[at], row->size - at + 1);
 
-    // if prevous word was a separator
-    //
-    if (prev_sep) {
+  // increase the size of the row
+  //
+  row->size++;
 
-      // index variable
-      //
-      int j;
+  // set the spare gap to a character
+  //
+  row->chars[at] = c;
 
-      // iterate through keywords
-      //
-      for (j = 0; keywords[j]; j++) {
+  // update the row
+  //
+  editorUpdateRow(row);
 
-        // find the length of the keyword
-        //
-        int klen = strlen(keywords[j]);
 
-        // check if extraneous character
-        //
-        int kw2 = keywords[j][klen - 1] == '|';
+  // modification tracking
+  //
+  E.dirty++;
+}
 
-        // if there is an extraneous char
-        // decrement length of keyword
-        //
-        if (kw2) {
-          klen--;
-        }
+void editorRowInsertChars(erow *row, const int *at, int n, int c) {
 
-        // check if the keyword is at the current position and that it is followed
-        // by a separator character
-        //
-        if (!strncmp(&row->render[i], keywords[j], klen) && is_separator(row->render[i + klen])) {
+  // put c in at each of the n positions, sorted from the
+  // left, moving every piece of the row once and laying
+  // the row out again once
+  //
+  editorRowReserve(row, n);
+  int end = row->size;
+  for (int k = n - 1; k >= 0; k--) {
+    memmove(&row->chars[at[k] + k + 1], &row->chars[at[k]], end - at[k]);
+    row->chars[at[k] + k] = c;
+    end = at[k];
+  }
+  row->size += n;
+  row->chars[row->size] = '\0';
+  editorUpdateRow(row);
+  E.dirty++;
+}
 
-          // set the memory of the highlight appropriately
-          //
-          memset(&row->hl[i], kw2 ? HL_KEYWORD2 : HL_KEYWORD1, klen);
-          
-          // increment by the keyword length
-          //
-          i += klen;
-          break;
-        }
-      }
+void editorInsertChar(int c) {
 
-      // check to see if it reached end of array
-      //
-      if (keywords[j] != NULL) {
-        prev_sep = 0;
-        continue;
-      }
-    }
+  // if at the end of the file
+  //
+  if (E.cy == E.numrows) {
 
-    // check if the chracter is a separator
-    //
-    prev_sep = is_separator(c);
-    
-    // incriment
+    // append a new blank row
     //
-    i++;
+    editorInsertRow(E.numrows, "", 0);
   }
 
-  // highlighting of next line won't change if
-  // not in a comment
-  //
-  int changed = (row->hl_open_comment != in_comment);
-  
-  // set open comment to current state of comment
+  // insert a character into the row
   //
-  row->hl_open_comment = in_comment;
-
-  // if it is changed and within the file
-  // then update syntax of the row after
-  if (changed && row->idx + 1 < E.numrows) {
-    editorUpdateSyntax(&E.row[row->idx + 1]);
-  }
-}
-int editorSyntaxToColor(int hl) {
+  editorRowInsertChar(&E.row[E.cy], E.cx, c);
 
-  // switch case with the numbers correlating
-  // to the appropriate colors
+  // increase cursor position by 1
   //
-  switch (hl) {
-    case HL_COMMENT:
-    case HL_MLCOMMENT: return 36;
-    case HL_KEYWORD1: return 33;
-    case HL_KEYWORD2: return 32;
-    case HL_STRING: return 35;
-    case HL_NUMBER: return 31;
-    case HL_MATCH: return 34;
-    default: return 37;
-  }
+  E.cx++;
 }
 
-/* End Syntax Actions */
-
-/* Cursor Actions */
-
-int getCursorPosition(int *rows, int *cols) {
+void editorRowAppendString(erow *row, char *s, size_t len) {
 
-  // variables to iterate through and read
-  // the response to the cursor position
+  // add memory equivalent to the amount of data needed
+  // to be added to the row
   //
-  char buf[32];
+  editorRowReserve(row, len);
 
-  // subtract the row offset from the screen
+  // copy the string to the end of the row
   //
-  snprintf(buf, sizeof(buf), "\x1b[%d;%dH", (E.cy - E.rowoff) + 1, E.cx + 1);
+  memcpy(&row->chars[row->size], s, len);
 
-  unsigned int i = 0;
+  // increase the size of the row
+  //
+  row->size += len;
 
-  // request cursor position
+  // add a null terminating character
   //
-  if (write(STDOUT_FILENO, "\x1b[6n", 4) != 4){
-    return -1;
-  }
+  row->chars[row->size] = '\0';
 
-  // move crusor to beginning of line and print new line
+  // update the row
   //
-  printf("\r\n");
-  
-  // read the cursor position byte by byte
+  editorUpdateRow(row);
+
+  // increment the modification counter
   //
-  while (i < sizeof(buf) - 1) {
+  E.dirty++;
+}
 
-    // if it fails to read break
-    // if it finds 'R' break
-    //
-    if (read(STDIN_FILENO, &buf[i], 1) != 1) break;
-    if (buf[i] == 'R') break;
-    i++;
-  }
+int editorRowCxToRx(erow *row, int cx) {
 
-  // set the last character to a null terminating character
+  // calculate position variable
   //
-  buf[i] = '\0';
-
-  // checks to see if it's an escape sequence
+  int rx = 0;
+  
+  // index variable
   //
-  if (buf[0] != '\x1b' || buf[1] != '['){
-
-    // return fail
-    //
-    return -1;
-  }
+  int j;
 
-  // read the two numbers that indicate cursor position
+  // loop through all characters
   //
-  if (sscanf(&buf[2], "%d;%d", rows, cols) != 2){
+  for (j = 0; j < cx; j++) {
 
-    // return fail
+    // if the character is a tab, set it to the
+    // appropriate amount of spaces
+    // and increment rx accordingly
     //
-    return -1;
+    if (row->chars[j] == '\t')
+      rx += (KILO_TAB_STOP - 1) - (rx % KILO_TAB_STOP);
+    rx++;
   }
 
-  // return success
+  // return the row variable
   //
-  return 0;
+  return rx;
 }
 
-void editorMoveCursor(int key) {
+int editorRowRxToCx(erow *row, int rx) {
   
-  // set the current row that we are on
+  // keep track of absolute cursor position
+  // and relative cursor position
   //
-  erow *row = (E.cy >= E.numrows) ? NULL : &E.row[E.cy];
+  int cur_rx = 0;
+  int cx;
 
-  // depending on the case move the cursor aroudn
-  // the if statements prevent the cursor from going
-  // off screen
-  //
-  switch (key) {
-    case ARROW_LEFT:
-      if (E.cx != 0) {
-        E.cx--;
-      }
-      else if (E.cy > 0) {
-        E.cy--;
-        E.cx = E.row[E.cy].size;
-      }
-      break;
-    case ARROW_RIGHT:
-      if (row && E.cx < row->size) {
-        E.cx++;
-      }
-      else if (row && E.cx == row->size) {
-        E.cy++;
-        E.cx = 0;
-      }
-      break;
-    case ARROW_UP:
-      if (E.cy != 0) {
-        E.cy--;
-      }
-      break;
-    case ARROW_DOWN:
-      if (E.cy < E.numrows-1) {
-        E.cy++;
-      }
-      break;
-  }
-  
-  // set the row again since we could be on a different 
-  // line
+  // iterate through the row
   //
-  row = (E.cy >= E.numrows) ? NULL : &E.row[E.cy];
+  for (cx = 0; cx < row->size; cx++) {
 
-  // set the length of the row
-  //
-  int rowlen = row ? row->size : 0;
+    // if tab is found convert from absolute spacing
+    // to relative spacing
+    //
+    if (row->chars[cx] == '\t')
+      cur_rx += (KILO_TAB_STOP - 1) - (cur_rx % KILO_TAB_STOP);
+    cur_rx++;
 
-  // if it's longer than the row
-  // reset to the end of the row
-  //
-  if (E.cx > rowlen) {
-    E.cx = rowlen;
+    if (cur_rx > rx) {
+      return cx;
+    }
   }
+  return cx;
 }
 
-void editorFindCallback(char *query, int key) {
-  
-  static char *match=NULL;
+// free up the memory of the row
+//
+void editorFreeRow(erow *row) {
+  editorParseClear(row);
+  free(row->render);
+  editorTextRelease(row->chars);
+  free(row->hl);
+}
 
-  // direction to search
-  //
-  int direction = 1;
+void editorDelRow(int at) {
 
-  // current line
+  // a range of one row
   //
-  int check_line = E.cy;
-  int i = check_line;
-  erow *row = &E.row[i];
-  
-  
+  editorDelRows(at, at + 1);
+}
 
-  if(match) {
-    editorUpdateRow(row);
-  }
+void editorDelRows(int a, int b) {
 
-  //if enter or escape return
+  // every row from a up to b goes in one pass instead
+  // of moving the rows below once for each of them
   //
-  if (key == '\x1b') {
-    // reset
-    //
-    direction = 1;
+  // check to see if the range holds any rows
+  //
+  if (a < 0) {
+    a = 0;
+  }
+  if (b > E.numrows) {
+    b = E.numrows;
+  }
+  if (a >= b) {
     return;
   }
-  // set search forwards
+  int n = b - a;
+
+  // unlink the rows from their neighbours and free
+  // them, text still on the clipboard stays
   //
-  else if (key == ARROW_DOWN) {
-    direction = 1;
-  } 
-  // set search backwards
+  uint64_t prev = a > 0 ? E.row[a - 1].hash : 0;
+  uint64_t next = b < E.numrows ? E.row[b].hash : 0;
+  for (int j = a; j < b; j++) {
+    E.hashes.link -= editorHashLink(prev, E.row[j].hash);
+    prev = E.row[j].hash;
+    editorFreeRow(&E.row[j]);
+  }
+  E.hashes.link -= editorHashLink(prev, next);
+  E.hashes.link += editorHashLink(a > 0 ? E.row[a - 1].hash : 0, next);
+
+  // close the gap once and move every
+  // index along with it
   //
-  else if (key == ARROW_UP) {
-    direction = -1;
+  memmove(&E.row[a], &E.row[b], sizeof(erow) * (E.numrows - b));
+  E.numrows -= n;
+  for (int j = a; j < E.numrows; j++) {
+    E.row[j].idx = j;
+    E.row[j].hl_queued = 0;
   }
-  else {
-    goto label;
+  editorFoldDeleteRows(a, n);
+  editorLayoutDeleteRows(a, n);
+  editorHighlightInvalidate(a);
+  editorBracketInvalidate(a);
+  editorPanesTouch(a, INT_MAX);
+  E.dirty++;
+
+  // the row that took their place now starts
+  // where the one above ends
+  //
+  if (a < E.numrows) {
+    editorParseRows(&E.row[a], 0);
+  }
+}
+
+void editorRowDelChar(erow *row, int at) {
+
+  // Check if valid index size
+  //
+  if (at < 0 || at >= row->size) {
+    return;
   }
 
+  // Perform the delete
+  //
+  editorRowReserve(row, 0);
+  memmove(&row->chars[at], &row->chars[at + 1], row->size - at);
+
+  // Decrement Row Size
+  //
+  row->size--;
   
+  // update the row
+  //
+  editorUpdateRow(row);
   
-  if(match!=NULL && query && row->render) {
-    char *match2 = strstr(match+1,query);
-    if(match2 != NULL) {
-      E.cy = i;
-      E.cx = match2 - row->render;
-      E.cx =  editorRowRxToCx(row, E.cx);
-      match = match2;
-      check_line = i;
-      goto label;
-    }
-    i+=direction;
-  }
+  // increment modification coutner
+  //
+  E.dirty++;
 
-  while(1) {
-    if(i >= E.numrows) {
-      i = 0;
-    }
-    if(i == -1) {
-      i = E.numrows - 1;
-    }
+}
 
-    row = &E.row[i];
-    if(query && row->render) {
-      match = strstr(row->render,query);
-    }
-    if(match) {
-      E.cy = i;
-      E.cx = match - row->render;
-      E.cx =  editorRowRxToCx(row, E.cx);
-      check_line = i;
-      goto label;
-    }
-    i+=direction;
-    
+void editorRowDelChars(erow *row, const int *at, int n) {
 
+  // take out the characters at the n different positions,
+  // sorted from the left, closing the gaps in one pass
+  //
+  editorRowReserve(row, 0);
+  int out = at[0];
+  int k = 0;
+  for (int i = at[0]; i < row->size; i++) {
+    if (k < n && i == at[k]) {
+      k++;
+      continue;
+    }
+    row->chars[out++] = row->chars[i];
   }
-  label:
-  if(match!=NULL) {
-    memset(&row->hl[E.cx],HL_MATCH,strlen(query));
-  }
+  row->size = out;
+  row->chars[row->size] = '\0';
+  editorUpdateRow(row);
+  E.dirty++;
 }
 
-void editorFind() {
+void editorDelChar() {
 
-  // save current cursor position
+  // check to see if at the end of the file
   //
-  int saved_cx = E.cx;
-  int saved_cy = E.cy;
-  int saved_coloff = E.coloff;
-  int saved_rowoff = E.rowoff;
+  if ((E.cy >= E.numrows) || (E.cx == 0 && E.cy == 0)){
+    return;
+  }
 
-  // prompt the user
-  //
-  char *query = editorPrompt("Search: %s (ESC to cancel) (UP/DOWN to search)", editorFindCallback);
 
-  // manage memory
+  // index the row
   //
-  if (query) {
-    free(query);
-  }
+  erow *row = &E.row[E.cy];
 
-  // // if query is null then restore cursor position
-  // //
-  // else {
-  //   E.cx = saved_cx;
-  //   E.cy = saved_cy;
-  //   E.coloff = saved_coloff;
-  //   E.rowoff = saved_rowoff;
-  // }
+  // Make sure that the cursor is within the row
+  //
+  if (E.cx > 0) {
+
+    // delete the character to the left
+    //
+    editorRowDelChar(row, E.cx - 1);
+
+    // decrement the row
+    //
+    E.cx--;
+  }
+
+  else {
+
+    // set cursor position to the end of the previous line
+    //
+    E.cx = E.row[E.cy - 1].size;
+
+    // Append the row below to the current row
+    //
+    editorRowAppendString(&E.row[E.cy - 1], row->chars, row->size);
+
+    // Delete the row below
+    //
+    editorDelRow(E.cy);
+    
+    // decrement the cursor y position
+    //
+    E.cy--;
+  }
 
 }
 
-void editorMoveCursorBeginRow() {
+void editorInsertNewline() {
+
+  // if at the beginning of a line
+  // insert a blank line
+  //
+  if (E.cx == 0) {
+    editorInsertRow(E.cy, "", 0);
+  } 
+  else {
+    
+    // index the row
+    //
+    erow *row = &E.row[E.cy];
+
+    // insert a row below the current one with the characters 
+    // after the cursor at the current line
+    //
+    editorInsertRow(E.cy + 1, &row->chars[E.cx], row->size - E.cx);
+
+    // index the previous row
+    //
+    row = &E.row[E.cy];
+
+    // update its size
+    // and add a null terminating character
+    //
+    editorRowReserve(row, 0);
+    row->size = E.cx;
+    row->chars[row->size] = '\0';
+
+    // update the row
+    //
+    editorUpdateRow(row);
+  }
+
+  // increase the cursor position and set it to the beginning
+  // of the next line
+  //
+  E.cy++;
   E.cx = 0;
 }
 
-void editorMoveCursorEndRow() {
+void editorDeleteRight() {
+
+  // index the row
+  //
   erow *row = &E.row[E.cy];
+
+  // check if empty row
+  //
+  if (row->size == 0) {
+    editorDelRow(E.cy);
+    return;
+  }
+
+  // Check if valid index size
+  //
+  if (E.cx < 0 || E.cx >= row->size || row->size == 0) {
+    return;
+  }
+
+  // Perform the delete
+  //
+  editorRowReserve(row, 0);
+  memmove(&row->chars[E.cx], &row->chars[row->size], 1);
+
+  // Decrement Row Size
+  //
+  row->size-=row->size - E.cx;
+  
+  // set the cursor position
+  //
   E.cx = row->size;
+
+  // update the row
+  //
+    editorUpdateRow(row);
+  
+  // increment modification coutner
+  //
+  E.dirty++;
 }
 
-void editorMoveCursorLeftWord() {
+/* End Text Actions */
 
-  erow *row = &E.row[E.cy];
-  char* curr = row->chars;
+/* Row Hashing */
+
+uint64_t editorHash64(const char *s, size_t len) {
+
+  // xxHash style, eight bytes at a time multiplied and
+  // rotated into the hash, then the bytes left over and
+  // a final mix so every bit of input reaches every bit
+  //
+  const uint64_t p1 = 11400714785074694791ULL;
+  const uint64_t p2 = 14029467366897019727ULL;
+  const uint64_t p3 = 1609587929392839161ULL;
+  const uint64_t p4 = 9650029242287828579ULL;
+  const uint64_t p5 = 2870177450012600261ULL;
+  uint64_t h = p5 + len;
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    uint64_t k;
+    memcpy(&k, s + i, 8);
+    k *= p2;
+    k = ROTL64(k, 31);
+    k *= p1;
+    h ^= k;
+    h = ROTL64(h, 27) * p1 + p4;
+  }
+  for (; i < len; i++) {
+    h ^= (unsigned char)s[i] * p5;
+    h = ROTL64(h, 11) * p1;
+  }
+  h ^= h >> 33;
+  h *= p2;
+  h ^= h >> 29;
+  h *= p3;
+  h ^= h >> 32;
 
-  if (E.cx == 0) {
-    if (E.cy == 0) {
-      return;
+  // zero marks a row that is not linked in yet
+  //
+  return h ? h : 1;
+}
+
+uint64_t editorHashLink(uint64_t a, uint64_t b) {
+
+  // hash of a row following another, the order
+  // of the two matters
+  //
+  uint64_t h = a * 14029467366897019727ULL + ROTL64(b, 31) * 11400714785074694791ULL;
+  h ^= h >> 33;
+  h *= 1609587929392839161ULL;
+  h ^= h >> 29;
+  return h;
+}
+
+void editorHashInsertRow(int at) {
+
+  // the row goes in between the two rows
+  // that used to follow each other
+  //
+  uint64_t prev = at > 0 ? E.row[at - 1].hash : 0;
+  uint64_t next = at + 1 < E.numrows ? E.row[at + 1].hash : 0;
+  uint64_t hash = E.row[at].hash;
+  E.hashes.link -= editorHashLink(prev, next);
+  E.hashes.link += editorHashLink(prev, hash) + editorHashLink(hash, next);
+}
+
+void editorHashSave() {
+
+  // the rows as they are now are what is
+  // on disk, nothing is modified
+  //
+  editorHashSaveFrom(0, 0);
+}
+
+void editorHashSaveFrom(int drop, int from) {
+
+  // the same, knowing the saved rows still match the rows
+  // before from once the first drop of them are taken off
+  // the top, a followed file only saves what came in
+  //
+  struct editorHashes *h = &E.hashes;
+  if (drop > h->nsaved) {
+    drop = h->nsaved;
+  }
+  if (drop > 0) {
+    memmove(h->saved, h->saved + drop, sizeof(uint64_t) * (h->nsaved - drop));
+  }
+  if (from > h->nsaved - drop) {
+    from = h->nsaved - drop;
+  }
+  if (from < 0) {
+    from = 0;
+  }
+  if (E.numrows + 1 > h->capsaved) {
+    while (E.numrows + 1 > h->capsaved) {
+      h->capsaved = h->capsaved ? h->capsaved * 2 : 64;
     }
-    else {
-      E.cy--;
-      row = &E.row[E.cy];
-      E.cx = row->size;
-      return;
+    h->saved = realloc(h->saved, sizeof(uint64_t) * h->capsaved);
+  }
+  for (int i = from; i < E.numrows; i++) {
+    h->saved[i] = E.row[i].hash;
+  }
+  h->nsaved = E.numrows;
+  h->saved_link = h->link;
+  E.dirty = 0;
+}
+
+int editorIsDirty() {
+
+  // nothing was done since the file was saved, or the
+  // rows tell it apart from what was saved in O(1)
+  //
+  struct editorHashes *h = &E.hashes;
+  if (E.dirty == 0) {
+    return 0;
+  }
+  if (h->link != h->saved_link || E.numrows != h->nsaved) {
+    return 1;
+  }
+
+  // otherwise the edits took it back to what was saved,
+  // make sure row by row once and remember it
+  //
+  for (int i = 0; i < E.numrows; i++) {
+    if (E.row[i].hash != h->saved[i]) {
+      return 1;
     }
   }
-  if (curr[E.cx] == ' ' || curr[E.cx] == '\t') {
-    if (curr[E.cx-1] != ' ' && curr[E.cx-1] != '\t'){
-      E.cx--;
+  E.dirty = 0;
+  return 0;
+}
+
+/* End Row Hashing */
+
+/* Soft Wrap Layout */
+
+int editorWrapWidth() {
+
+  // rows wrap at the width of the screen
+  //
+  return E.screencols > 0 ? E.screencols : 1;
+}
+
+int editorRowHeight(erow *row) {
+
+  // rows folded away take up no lines and without
+  // wrapping every other row is one line
+  //
+  if (editorFoldHidden(row->idx)) {
+    return 0;
+  }
+  if (!E.wrap) {
+    return 1;
+  }
+
+  // a row that exactly fills its last line gets an extra
+  // empty line so the cursor has somewhere to sit
+  //
+  return row->rsize / editorWrapWidth() + 1;
+}
+
+void editorLayoutFree() {
+
+  // release the index and mark it as not built
+  //
+  free(E.layout.heights);
+  free(E.layout.tree);
+  memset(&E.layout, 0, sizeof(E.layout));
+}
+
+void editorLayoutBuild() {
+
+  // index the layout
+  //
+  struct editorLayout *l = &E.layout;
+
+  // make room for every row
+  //
+  if (E.numrows + 1 > l->cap) {
+    l->cap = E.numrows + 1;
+    l->heights = realloc(l->heights, sizeof(int) * l->cap);
+    l->tree = realloc(l->tree, sizeof(int) * (l->cap + 1));
+  }
+
+  // lay out every row at the current width
+  //
+  for (int j = 0; j < E.numrows; j++) {
+    l->heights[j] = editorRowHeight(&E.row[j]);
+  }
+  l->n = E.numrows;
+  l->width = editorWrapWidth();
+  l->stale = 1;
+}
+
+void editorLayoutEnsure() {
+
+  // index the layout
+  //
+  struct editorLayout *l = &E.layout;
+
+  // lay out everything again if it was never built
+  // or the width changed underneath it
+  //
+  if (l->width != editorWrapWidth()) {
+    editorLayoutBuild();
+  }
+
+  // rebuild the fenwick tree from the heights in
+  // linear time, each node pushes its sum to its parent
+  //
+  if (l->stale) {
+    l->tree[0] = 0;
+    for (int i = 1; i <= l->n; i++) {
+      l->tree[i] = l->heights[i - 1];
     }
-    else {
-      while (curr[E.cx] == ' ' || curr[E.cx] == '\t') {
-        if (E.cx == 0){
-          return;
-        }
-        E.cx--;
+    for (int i = 1; i <= l->n; i++) {
+      int parent = i + (i & -i);
+      if (parent <= l->n) {
+        l->tree[parent] += l->tree[i];
       }
-      E.cx++;
-      return;
     }
+    l->stale = 0;
   }
-  
-  if (curr[E.cx] != ' ' && curr[E.cx] != '\t') {
-    if (curr[E.cx-1] == ' ' || curr[E.cx-1] == '\t'){
-        while (curr[E.cx] == ' ' || curr[E.cx] == '\t') {
-          if (E.cx == 0){
-            return;
-          }
-          E.cx--;
-        }
-        if (E.cx == 0){
-            return;
-        }
-        E.cx--;
-        return;
-      }
-    else{
-      while (curr[E.cx] != ' ' && curr[E.cx] != '\t') {
-        if (E.cx == 0) {
-          return;
-        }
-        E.cx--;
-      }
-      E.cx++;
-      return;
+}
+
+void editorLayoutInsertRows(int at, int n) {
+
+  // index the layout
+  //
+  struct editorLayout *l = &E.layout;
+
+  // nothing to keep up to date if the index isn't built
+  //
+  if (!editorLayoutActive() || l->width == 0) {
+    return;
+  }
+
+  // grow the index by doubling
+  //
+  if (l->n + n > l->cap) {
+    while (l->n + n > l->cap) {
+      l->cap = l->cap ? l->cap * 2 : 16;
     }
+    l->heights = realloc(l->heights, sizeof(int) * l->cap);
+    l->tree = realloc(l->tree, sizeof(int) * (l->cap + 1));
+  }
+
+  // shift the heights after the new rows, the new rows
+  // get laid out when they are updated
+  //
+  memmove(&l->heights[at + n], &l->heights[at], sizeof(int) * (l->n - at));
+  for (int j = at; j < at + n; j++) {
+    l->heights[j] = 1;
+  }
+  l->n += n;
+  l->stale = 1;
+}
+
+void editorLayoutDeleteRows(int at, int n) {
+
+  // index the layout
+  //
+  struct editorLayout *l = &E.layout;
+
+  // nothing to keep up to date if the index isn't built
+  //
+  if (!editorLayoutActive() || l->width == 0 || at >= l->n) {
+    return;
+  }
+  if (at + n > l->n) {
+    n = l->n - at;
+  }
+
+  // close the gap left by the rows
+  //
+  memmove(&l->heights[at], &l->heights[at + n], sizeof(int) * (l->n - at - n));
+  l->n -= n;
+  l->stale = 1;
+}
+
+void editorLayoutUpdateRow(int at) {
+
+  // index the layout
+  //
+  struct editorLayout *l = &E.layout;
+
+  // nothing to keep up to date if the index isn't built
+  //
+  if (!editorLayoutActive() || l->width == 0 || at >= l->n) {
+    return;
+  }
+
+  // lay out only this row and leave the
+  // index alone if its height didn't change
+  //
+  int delta = editorRowHeight(&E.row[at]) - l->heights[at];
+  if (delta == 0) {
+    return;
+  }
+  l->heights[at] += delta;
+
+  // every visual line below moved
+  //
+  editorPanesTouch(at, INT_MAX);
+
+  // push the difference up the fenwick tree unless
+  // it is getting rebuilt anyway
+  //
+  if (!l->stale) {
+    for (int i = at + 1; i <= l->n; i += i & -i) {
+      l->tree[i] += delta;
+    }
+  }
+}
+
+int editorLayoutLineOfRow(int at) {
+
+  // without wrapping or folds rows and lines are the same
+  //
+  if (!editorLayoutActive()) {
+    return at;
+  }
+  editorLayoutEnsure();
+
+  // clamp to the end of the file
+  //
+  if (at > E.layout.n) {
+    at = E.layout.n;
+  }
+
+  // sum the heights of every row above
+  //
+  int line = 0;
+  for (int i = at; i > 0; i -= i & -i) {
+    line += E.layout.tree[i];
+  }
+  return line;
+}
+
+int editorLayoutRowOfLine(int line, int *sub) {
+
+  // without wrapping or folds rows and lines are the same
+  //
+  *sub = 0;
+  if (!editorLayoutActive()) {
+    return line;
+  }
+  editorLayoutEnsure();
+  if (line < 0) {
+    return 0;
+  }
+
+  // find the largest number of rows whose heights add
+  // up to no more than line by walking down the tree
+  //
+  struct editorLayout *l = &E.layout;
+  int pos = 0;
+  int step = 1;
+  while (step * 2 <= l->n) {
+    step *= 2;
+  }
+  for (; step > 0; step /= 2) {
+    if (pos + step <= l->n && l->tree[pos + step] <= line) {
+      pos += step;
+      line -= l->tree[pos];
+    }
+  }
+
+  // whatever is left over is the segment within the row,
+  // folded rows have no lines so the walk passes them
+  //
+  *sub = (pos < l->n) ? line : 0;
+  return pos;
+}
+
+int editorLayoutTotal() {
+
+  // total number of visual lines in the file
+  //
+  return editorLayoutLineOfRow(E.numrows);
+}
+
+void editorToggleWrap() {
+
+  // keep the same row at the top of the screen, rowoff
+  // counts file rows or visual lines depending on the mode
+  //
+  int sub;
+  int top = editorLayoutRowOfLine(E.rowoff, &sub);
+  if (top > E.numrows) {
+    top = E.numrows;
+  }
+
+  // switch modes and drop the old index
+  //
+  E.wrap = !E.wrap;
+  editorLayoutFree();
+  E.rowoff = editorLayoutLineOfRow(top);
+  E.coloff = 0;
+
+  editorSetStatusMessage("Soft wrap %s", E.wrap ? "on" : "off");
+}
+
+/* End Soft Wrap Layout */
+
+/* Syntax Database */
+
+uint32_t editorSyntaxHash(const char *s, int len) {
+
+  // fnv-1a over the bytes of the word
+  //
+  uint32_t h = 2166136261u;
+  for (int j = 0; j < len; j++) {
+    h ^= (unsigned char)s[j];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+int editorSyntaxKeyword(struct editorSyntax *syntax, const char *s, int len) {
+
+  // nothing to look up
+  //
+  if (syntax->kwtable == NULL || len == 0) {
+    return 0;
+  }
+
+  // probe the open addressed table from the slot the hash
+  // lands on until an empty slot is found
+  //
+  uint32_t h = editorSyntaxHash(s, len);
+  for (uint32_t slot = h & syntax->kwmask; ; slot = (slot + 1) & syntax->kwmask) {
+    const struct editorKeyword *k = &syntax->kwtable[slot];
+    if (k->name == 0) {
+      return 0;
+    }
+    if (k->hash == h && k->len == len && !memcmp(syntax->kwpool + k->name, s, len)) {
+      return k->kind;
+    }
+  }
+}
+
+void editorSyntaxDefFree(struct editorSyntaxDef *d) {
+
+  // free every string and list of the definition
+  //
+  free(d->filetype);
+  free(d->scs);
+  free(d->mcs);
+  free(d->mce);
+  for (int j = 0; j < d->nfilematch; j++) {
+    free(d->filematch[j]);
+  }
+  for (int j = 0; j < d->nshebangs; j++) {
+    free(d->shebangs[j]);
+  }
+  for (int j = 0; j < d->nkeywords; j++) {
+    free(d->keywords[j]);
+  }
+  free(d->filematch);
+  free(d->shebangs);
+  free(d->keywords);
+  memset(d, 0, sizeof(*d));
+}
+
+void editorSyntaxDefAdd(char ***list, int *n, const char *word, int len) {
+
+  // append a copy of the word to the list
+  //
+  *list = realloc(*list, sizeof(char *) * (*n + 1));
+  (*list)[*n] = strndup(word, len);
+  (*n)++;
+}
+
+int editorSyntaxDefParse(const char *path, struct editorSyntaxDef *d) {
+
+  // open the definition file
+  //
+  FILE *fp = fopen(path, "r");
+  if (!fp) {
+    return -1;
+  }
+  memset(d, 0, sizeof(*d));
+
+  // variables for reading lines
+  //
+  char *line = NULL;
+  size_t linecap = 0;
+  ssize_t linelen;
+
+  // every line is a directive followed by words
+  //
+  while ((linelen = getline(&line, &linecap, fp)) != -1) {
+
+    // split the line into words
+    //
+    char *words[64];
+    int nwords = 0;
+    char *save = NULL;
+    for (char *w = strtok_r(line, " \t\r\n", &save); w && nwords < 64; w = strtok_r(NULL, " \t\r\n", &save)) {
+      words[nwords++] = w;
+    }
+
+    // skip blank lines and comments
+    //
+    if (nwords == 0 || words[0][0] == '#') {
+      continue;
+    }
+
+    // fill in the definition
+    //
+    char *dir = words[0];
+    if (!strcmp(dir, "filetype") && nwords > 1) {
+      free(d->filetype);
+      d->filetype = strdup(words[1]);
+    }
+    else if (!strcmp(dir, "extensions") || !strcmp(dir, "filematch")) {
+      for (int j = 1; j < nwords; j++) {
+        editorSyntaxDefAdd(&d->filematch, &d->nfilematch, words[j], strlen(words[j]));
+      }
+    }
+    else if (!strcmp(dir, "shebang")) {
+      for (int j = 1; j < nwords; j++) {
+        editorSyntaxDefAdd(&d->shebangs, &d->nshebangs, words[j], strlen(words[j]));
+      }
+    }
+    else if (!strcmp(dir, "comment") && nwords > 1) {
+      free(d->scs);
+      d->scs = strdup(words[1]);
+    }
+    else if (!strcmp(dir, "multiline") && nwords > 2) {
+      free(d->mcs);
+      free(d->mce);
+      d->mcs = strdup(words[1]);
+      d->mce = strdup(words[2]);
+    }
+    else if (!strcmp(dir, "highlight")) {
+      for (int j = 1; j < nwords; j++) {
+        if (!strcmp(words[j], "numbers")) {
+          d->flags |= HL_HIGHLIGHT_NUMBERS;
+        }
+        else if (!strcmp(words[j], "strings")) {
+          d->flags |= HL_HIGHLIGHT_STRINGS;
+        }
+        else if (!strcmp(words[j], "structure")) {
+          d->flags |= HL_HIGHLIGHT_STRUCTURE;
+        }
+      }
+    }
+
+    // keywords of the second kind keep the old trailing
+    // bar so both kinds live in one list
+    //
+    else if (!strcmp(dir, "keywords") || !strcmp(dir, "types")) {
+      for (int j = 1; j < nwords; j++) {
+        char word[128];
+        int len = snprintf(word, sizeof(word), "%s%s", words[j], dir[0] == 't' ? "|" : "");
+        if (len < (int)sizeof(word)) {
+          editorSyntaxDefAdd(&d->keywords, &d->nkeywords, word, len);
+        }
+      }
+    }
+  }
+  free(line);
+  fclose(fp);
+
+  // a definition needs a name and something to match
+  //
+  if (d->filetype == NULL || d->nfilematch + d->nshebangs == 0) {
+    editorSyntaxDefFree(d);
+    return -1;
+  }
+  return 0;
+}
+
+uint32_t editorSyntaxPoolString(struct abuf *pool, const char *s) {
+
+  // absent strings are offset zero
+  //
+  if (s == NULL) {
+    return 0;
+  }
+
+  // copy the string with its terminator
+  //
+  uint32_t off = pool->len;
+  abAppend(pool, s, strlen(s) + 1);
+  return off;
+}
+
+void editorSyntaxPoolAlign(struct abuf *pool) {
+
+  // keep tables in the pool four byte aligned
+  //
+  while (pool->len % 4) {
+    abAppend(pool, "", 1);
+  }
+}
+
+uint32_t editorSyntaxPoolList(struct abuf *pool, char **list, int n) {
+
+  // write the strings and then a zero terminated
+  // array of their offsets
+  //
+  uint32_t *offs = malloc(sizeof(uint32_t) * (n + 1));
+  for (int j = 0; j < n; j++) {
+    offs[j] = editorSyntaxPoolString(pool, list[j]);
+  }
+  offs[n] = 0;
+  editorSyntaxPoolAlign(pool);
+  uint32_t off = pool->len;
+  abAppend(pool, (char *)offs, sizeof(uint32_t) * (n + 1));
+  free(offs);
+  return off;
+}
+
+void editorSyntaxCompile(struct editorSyntaxDef *defs, int ndefs, uint64_t fingerprint, struct abuf *blob) {
+
+  // entries and the pool they point into, the pool starts
+  // with a word of zeroes so no string sits at offset zero
+  //
+  struct editorSyntaxEntry *entries = calloc(ndefs ? ndefs : 1, sizeof(struct editorSyntaxEntry));
+  struct abuf pool = ABUF_INIT;
+  abAppend(&pool, "\0\0\0\0", 4);
+
+  // compile each definition
+  //
+  for (int i = 0; i < ndefs; i++) {
+    struct editorSyntaxDef *d = &defs[i];
+    struct editorSyntaxEntry *e = &entries[i];
+
+    e->filetype = editorSyntaxPoolString(&pool, d->filetype);
+    e->filematch = editorSyntaxPoolList(&pool, d->filematch, d->nfilematch);
+    e->shebang = editorSyntaxPoolList(&pool, d->shebangs, d->nshebangs);
+    e->scs = editorSyntaxPoolString(&pool, d->scs);
+    e->mcs = editorSyntaxPoolString(&pool, d->mcs);
+    e->mce = editorSyntaxPoolString(&pool, d->mce);
+    e->flags = d->flags;
+
+    // size the keyword table to a power of two at least
+    // twice the number of keywords so probes stay short
+    //
+    uint32_t size = 8;
+    while (size < (uint32_t)d->nkeywords * 2) {
+      size *= 2;
+    }
+    struct editorKeyword *table = calloc(size, sizeof(struct editorKeyword));
+
+    // hash every keyword into the table, the trailing
+    // bar picks the second keyword color
+    //
+    for (int j = 0; j < d->nkeywords; j++) {
+      int len = strlen(d->keywords[j]);
+      int kind = HL_KEYWORD1;
+      if (len > 1 && d->keywords[j][len - 1] == '|') {
+        kind = HL_KEYWORD2;
+        len--;
+      }
+      uint32_t h = editorSyntaxHash(d->keywords[j], len);
+      uint32_t slot = h & (size - 1);
+      while (table[slot].name != 0) {
+        slot = (slot + 1) & (size - 1);
+      }
+      table[slot].hash = h;
+      table[slot].name = pool.len;
+      table[slot].len = len;
+      table[slot].kind = kind;
+      abAppend(&pool, d->keywords[j], len);
+      abAppend(&pool, "", 1);
+    }
+
+    // store the table in the pool
+    //
+    editorSyntaxPoolAlign(&pool);
+    e->keywords = pool.len;
+    e->kwmask = size - 1;
+    abAppend(&pool, (char *)table, sizeof(struct editorKeyword) * size);
+    free(table);
+  }
+
+  // the header goes first then the entries and the pool
+  //
+  struct editorSyntaxHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, KILO_SYNTAX_MAGIC, sizeof(h.magic));
+  h.version = KILO_SYNTAX_VERSION;
+  h.entries = ndefs;
+  h.fingerprint = fingerprint;
+  h.pool = sizeof(h) + sizeof(struct editorSyntaxEntry) * ndefs;
+  h.size = h.pool + pool.len;
+
+  abAppend(blob, (char *)&h, sizeof(h));
+  abAppend(blob, (char *)entries, sizeof(struct editorSyntaxEntry) * ndefs);
+  abAppend(blob, pool.b, pool.len);
+
+  free(entries);
+  abFree(&pool);
+}
+
+char **editorSyntaxAttachList(const char *pool, uint32_t off) {
+
+  // turn an array of pool offsets into an array of strings
+  //
+  const uint32_t *offs = (const uint32_t *)(pool + off);
+  int n = 0;
+  while (offs[n]) {
+    n++;
+  }
+  char **list = malloc(sizeof(char *) * (n + 1));
+  for (int j = 0; j < n; j++) {
+    list[j] = (char *)pool + offs[j];
+  }
+  list[n] = NULL;
+  return list;
+}
+
+int editorSyntaxValidString(const char *pool, uint32_t poolsize, uint32_t off) {
+
+  // the string has to end inside the pool
+  //
+  return off < poolsize && memchr(pool + off, '\0', poolsize - off) != NULL;
+}
+
+int editorSyntaxValidList(const char *pool, uint32_t poolsize, uint32_t off) {
+
+  // an aligned array of string offsets with
+  // its zero before the end of the pool
+  //
+  if (off % 4) {
+    return 0;
+  }
+  for (uint64_t at = off; at + sizeof(uint32_t) <= poolsize; at += sizeof(uint32_t)) {
+    uint32_t str;
+    memcpy(&str, pool + at, sizeof(str));
+    if (str == 0) {
+      return 1;
+    }
+    if (!editorSyntaxValidString(pool, poolsize, str)) {
+      return 0;
+    }
+  }
+  return 0;
+}
+
+int editorSyntaxValidEntry(const struct editorSyntaxEntry *e, const char *pool, uint32_t poolsize) {
+
+  // every string the entry points at
+  //
+  if (!editorSyntaxValidString(pool, poolsize, e->filetype) ||
+      !editorSyntaxValidList(pool, poolsize, e->filematch) ||
+      !editorSyntaxValidList(pool, poolsize, e->shebang)) {
+    return 0;
+  }
+  if ((e->scs && !editorSyntaxValidString(pool, poolsize, e->scs)) ||
+      (e->mcs && !editorSyntaxValidString(pool, poolsize, e->mcs)) ||
+      (e->mce && !editorSyntaxValidString(pool, poolsize, e->mce))) {
+    return 0;
+  }
+
+  // a whole table of a power of two slots, each
+  // keyword with its name inside the pool and at
+  // least one slot empty so a probe for a word
+  // that is not there stops
+  //
+  uint64_t slots = (uint64_t)e->kwmask + 1;
+  if ((slots & (slots - 1)) || e->keywords % 4 || e->keywords + slots * sizeof(struct editorKeyword) > poolsize) {
+    return 0;
+  }
+  const struct editorKeyword *table = (const struct editorKeyword *)(pool + e->keywords);
+  int empty = 0;
+  for (uint64_t j = 0; j < slots; j++) {
+    if (table[j].name == 0) {
+      empty = 1;
+    }
+    else if ((uint64_t)table[j].name + table[j].len >= poolsize) {
+      return 0;
+    }
+  }
+  return empty;
+}
+
+int editorSyntaxAttach(const char *blob, size_t size, uint64_t fingerprint) {
+
+  // check the blob was compiled by this version from
+  // the same definition files
+  //
+  const struct editorSyntaxHeader *h = (const struct editorSyntaxHeader *)blob;
+  if (size < sizeof(*h) || memcmp(h->magic, KILO_SYNTAX_MAGIC, sizeof(h->magic)) || h->version != KILO_SYNTAX_VERSION || h->fingerprint != fingerprint || h->size != size) {
+    return -1;
+  }
+
+  // the entries and the pool have to fit and every offset
+  // has to stay inside the pool, a cache that was cut short
+  // or damaged is a miss like any other
+  //
+  if (h->pool % 4 || h->pool > size || h->pool < sizeof(*h) + (uint64_t)h->entries * sizeof(struct editorSyntaxEntry)) {
+    return -1;
+  }
+  const struct editorSyntaxEntry *entries = (const struct editorSyntaxEntry *)(blob + sizeof(*h));
+  const char *pool = blob + h->pool;
+  uint32_t poolsize = size - h->pool;
+  for (uint32_t i = 0; i < h->entries; i++) {
+    if (!editorSyntaxValidEntry(&entries[i], pool, poolsize)) {
+      return -1;
+    }
+  }
+
+  // point a syntax entry at each compiled entry,
+  // only the lists of strings need allocating
+  //
+  E.hldb = calloc(h->entries ? h->entries : 1, sizeof(struct editorSyntax));
+  E.hldb_entries = h->entries;
+  for (uint32_t i = 0; i < h->entries; i++) {
+    const struct editorSyntaxEntry *e = &entries[i];
+    struct editorSyntax *s = &E.hldb[i];
+    s->filetype = (char *)pool + e->filetype;
+    s->filematch = editorSyntaxAttachList(pool, e->filematch);
+    s->shebangs = editorSyntaxAttachList(pool, e->shebang);
+    s->singleline_comment_start = e->scs ? (char *)pool + e->scs : NULL;
+    s->multiline_comment_start = e->mcs ? (char *)pool + e->mcs : NULL;
+    s->multiline_comment_end = e->mce ? (char *)pool + e->mce : NULL;
+    s->flags = e->flags;
+    s->kwtable = (const struct editorKeyword *)(pool + e->keywords);
+    s->kwmask = e->kwmask;
+    s->kwpool = pool;
+    editorLexerCompile(s);
+  }
+  return 0;
+}
+
+int editorSyntaxCachePath(char *path, size_t size, int create) {
+
+  // the cache lives under the xdg cache directory
+  //
+  char dir[PATH_MAX];
+  char *xdg = getenv("XDG_CACHE_HOME");
+  char *home = getenv("HOME");
+  if (xdg && xdg[0]) {
+    snprintf(dir, sizeof(dir), "%s", xdg);
+  }
+  else if (home && home[0]) {
+    snprintf(dir, sizeof(dir), "%s/.cache", home);
+  }
+  else {
+    return -1;
+  }
+
+  // make the directories on the way when writing
+  //
+  if (create) {
+    mkdir(dir, 0755);
+    strncat(dir, "/kilo", sizeof(dir) - strlen(dir) - 1);
+    mkdir(dir, 0755);
+  }
+  else {
+    strncat(dir, "/kilo", sizeof(dir) - strlen(dir) - 1);
+  }
+  snprintf(path, size, "%s/syntax.db", dir);
+  return 0;
+}
+
+void editorSyntaxCacheWrite(struct abuf *blob) {
+
+  // find where the cache goes
+  //
+  char path[PATH_MAX];
+  char tmp[PATH_MAX + 16];
+  if (editorSyntaxCachePath(path, sizeof(path), 1) == -1) {
+    return;
+  }
+
+  // write a temporary file and rename it over the cache so
+  // another kilo never maps a half written file
+  //
+  snprintf(tmp, sizeof(tmp), "%s.%d", path, (int)getpid());
+  int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd == -1) {
+    return;
+  }
+  if (write(fd, blob->b, blob->len) != blob->len) {
+    close(fd);
+    unlink(tmp);
+    return;
+  }
+  close(fd);
+  if (rename(tmp, path) == -1) {
+    unlink(tmp);
+  }
+}
+
+int editorSyntaxCacheLoad(uint64_t fingerprint) {
+
+  // open the cache
+  //
+  char path[PATH_MAX];
+  if (editorSyntaxCachePath(path, sizeof(path), 0) == -1) {
+    return -1;
+  }
+  int fd = open(path, O_RDONLY);
+  if (fd == -1) {
+    return -1;
+  }
+
+  // map it, the mapping stays for the life of the program
+  // since the syntax entries point straight into it
+  //
+  struct stat st;
+  if (fstat(fd, &st) == -1 || st.st_size < (off_t)sizeof(struct editorSyntaxHeader)) {
+    close(fd);
+    return -1;
+  }
+  void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return -1;
+  }
+  if (editorSyntaxAttach(map, st.st_size, fingerprint) == -1) {
+    munmap(map, st.st_size);
+    return -1;
+  }
+  return 0;
+}
+
+int editorSyntaxNameCompare(const void *a, const void *b) {
+
+  // sort definition files by path
+  //
+  return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+int editorSyntaxListFiles(char ***paths, uint64_t *fingerprint) {
+
+  // directories to look in, the user's own
+  // definitions come first so they win
+  //
+  char userdir[PATH_MAX] = "";
+  char *home = getenv("HOME");
+  char *env = getenv("KILO_SYNTAX_DIR");
+  if (home && home[0]) {
+    snprintf(userdir, sizeof(userdir), "%s/.config/kilo/syntax", home);
+  }
+  const char *dirs[] = { env, userdir, KILO_SYNTAX_DIR };
+
+  // fingerprint the names, sizes and modification times
+  // so the cache is rebuilt when any file changes
+  //
+  uint64_t fp = 14695981039346656037ull;
+  int n = 0;
+  *paths = NULL;
+  for (unsigned int d = 0; d < sizeof(dirs) / sizeof(dirs[0]); d++) {
+    if (dirs[d] == NULL || dirs[d][0] == '\0') {
+      continue;
+    }
+    DIR *dp = opendir(dirs[d]);
+    if (dp == NULL) {
+      continue;
+    }
+
+    // collect the definition files of this directory
+    //
+    int first = n;
+    struct dirent *de;
+    while ((de = readdir(dp)) != NULL) {
+      int len = strlen(de->d_name);
+      if (len <= 7 || strcmp(de->d_name + len - 7, ".syntax")) {
+        continue;
+      }
+      char path[PATH_MAX];
+      snprintf(path, sizeof(path), "%s/%s", dirs[d], de->d_name);
+      *paths = realloc(*paths, sizeof(char *) * (n + 1));
+      (*paths)[n++] = strdup(path);
+    }
+    closedir(dp);
+    qsort(*paths + first, n - first, sizeof(char *), editorSyntaxNameCompare);
+  }
+
+  // mix each file into the fingerprint
+  //
+  for (int j = 0; j < n; j++) {
+    struct stat st;
+    long long stamp[3] = { 0, 0, 0 };
+    if (stat((*paths)[j], &st) == 0) {
+      stamp[0] = st.st_size;
+      stamp[1] = st.st_mtim.tv_sec;
+      stamp[2] = st.st_mtim.tv_nsec;
+    }
+    const unsigned char *parts[2] = { (const unsigned char *)(*paths)[j], (const unsigned char *)stamp };
+    size_t lens[2] = { strlen((*paths)[j]), sizeof(stamp) };
+    for (int p = 0; p < 2; p++) {
+      for (size_t k = 0; k < lens[p]; k++) {
+        fp ^= parts[p][k];
+        fp *= 1099511628211ull;
+      }
+    }
+  }
+  *fingerprint = fp;
+  return n;
+}
+
+void editorSyntaxInit() {
+
+  // find the definition files
+  //
+  char **paths;
+  uint64_t fingerprint;
+  int npaths = editorSyntaxListFiles(&paths, &fingerprint);
+
+  // use the compiled cache when it matches the files
+  //
+  if (npaths > 0 && editorSyntaxCacheLoad(fingerprint) == 0) {
+    for (int j = 0; j < npaths; j++) {
+      free(paths[j]);
+    }
+    free(paths);
+    return;
+  }
+
+  // parse every definition file
+  //
+  struct editorSyntaxDef *defs = calloc(npaths ? npaths : 1, sizeof(struct editorSyntaxDef));
+  int ndefs = 0;
+  for (int j = 0; j < npaths; j++) {
+    if (editorSyntaxDefParse(paths[j], &defs[ndefs]) == 0) {
+      ndefs++;
+    }
+    free(paths[j]);
+  }
+  free(paths);
+
+  // with nothing found fall back to the built in entries
+  //
+  int builtin = (ndefs == 0);
+  if (builtin) {
+    defs = realloc(defs, sizeof(struct editorSyntaxDef) * HLDB_ENTRIES);
+    for (unsigned int i = 0; i < HLDB_ENTRIES; i++) {
+      struct editorSyntaxDef *d = &defs[ndefs++];
+      memset(d, 0, sizeof(*d));
+      d->filetype = strdup(HLDB[i].filetype);
+      for (int j = 0; HLDB[i].filematch[j]; j++) {
+        editorSyntaxDefAdd(&d->filematch, &d->nfilematch, HLDB[i].filematch[j], strlen(HLDB[i].filematch[j]));
+      }
+      for (int j = 0; HLDB[i].keywords[j]; j++) {
+        editorSyntaxDefAdd(&d->keywords, &d->nkeywords, HLDB[i].keywords[j], strlen(HLDB[i].keywords[j]));
+      }
+      d->scs = HLDB[i].singleline_comment_start ? strdup(HLDB[i].singleline_comment_start) : NULL;
+      d->mcs = HLDB[i].multiline_comment_start ? strdup(HLDB[i].multiline_comment_start) : NULL;
+      d->mce = HLDB[i].multiline_comment_end ? strdup(HLDB[i].multiline_comment_end) : NULL;
+      d->flags = HLDB[i].flags;
+    }
+  }
+
+  // compile the definitions into one blob and attach to it,
+  // the blob is kept for the life of the program
+  //
+  struct abuf blob = ABUF_INIT;
+  editorSyntaxCompile(defs, ndefs, fingerprint, &blob);
+  editorSyntaxAttach(blob.b, blob.len, fingerprint);
+  for (int j = 0; j < ndefs; j++) {
+    editorSyntaxDefFree(&defs[j]);
+  }
+  free(defs);
+
+  // save it for the next start
+  //
+  if (!builtin) {
+    editorSyntaxCacheWrite(&blob);
+  }
+}
+
+int editorSyntaxMatchShebang(struct editorSyntax *s) {
+
+  // the first row has to start with #!
+  //
+  if (E.numrows == 0 || E.row[0].size < 3 || strncmp(E.row[0].chars, "#!", 2)) {
+    return 0;
+  }
+
+  // take the name of the interpreter, looking past env
+  //
+  char line[256];
+  snprintf(line, sizeof(line), "%s", E.row[0].chars + 2);
+  char *save = NULL;
+  char *word = strtok_r(line, " \t", &save);
+  char *interp = NULL;
+  while (word) {
+    char *base = strrchr(word, '/');
+    base = base ? base + 1 : word;
+    if (strcmp(base, "env") && base[0] != '-') {
+      interp = base;
+      break;
+    }
+    word = strtok_r(NULL, " \t", &save);
+  }
+  if (interp == NULL) {
+    return 0;
+  }
+
+  // an interpreter matches a name followed by nothing
+  // but a version number
+  //
+  for (int j = 0; s->shebangs && s->shebangs[j]; j++) {
+    int len = strlen(s->shebangs[j]);
+    if (strncmp(interp, s->shebangs[j], len)) {
+      continue;
+    }
+    if (strspn(interp + len, "0123456789.") == strlen(interp + len)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* End Syntax Database */
+
+
+/* Syntax Actions */
+
+void editorSelectSyntaxHighlight() {
+
+  // reset syntax of row
+  //
+  E.syntax = NULL;
+
+  // if no filename
+  // exit
+  //
+  if (E.filename == NULL) {
+    return;
+  }
+
+  // find the extension
+  //
+  char *ext = strrchr(E.filename, '.');
+
+  // iterate through the highlate database entries
+  //
+  for (unsigned int j = 0; j < E.hldb_entries && E.syntax == NULL; j++) {
+
+    // index the highlight database
+    //
+    struct editorSyntax *s = &E.hldb[j];
+
+    // index variable
+    //
+    unsigned int i = 0;
+
+    // iterate through check for file extensions
+    //
+    while (s->filematch[i]) {
+      int is_ext = (s->filematch[i][0] == '.');
+
+      // if there is an extension check to see if it matches
+      // otherwise check if the extension is in the filename
+      // 
+      if ((is_ext && ext && !strcmp(ext, s->filematch[i])) || (!is_ext && strstr(E.filename, s->filematch[i]))) {
+        
+        // set the correct syntax database
+        //
+        E.syntax = s;
+        break;
+      }
+
+      // increment the variable
+      //
+      i++;
+    }
+  }
+
+  // with no extension matching look at the
+  // interpreter on the first line
+  //
+  for (unsigned int j = 0; j < E.hldb_entries && E.syntax == NULL; j++) {
+    if (editorSyntaxMatchShebang(&E.hldb[j])) {
+      E.syntax = &E.hldb[j];
+    }
+  }
+
+  // with the background highlighter running every row
+  // just has to be done again
+  //
+  if (E.hlworker.running && E.syntax) {
+    for (int filerow = 0; filerow < E.numrows; filerow++) {
+      E.row[filerow].hl_done = 0;
+    }
+    editorHighlightInvalidate(0);
+    return;
+  }
+
+  // loop through the file rows and update the syntax for
+  // each row
+  //
+  if (E.syntax) {
+    int filerow;
+    for (filerow = 0; filerow < E.numrows; filerow++) {
+      editorUpdateSyntax(&E.row[filerow]);
+    }
+  }
+}
+
+int is_separator(int c) {
+
+  // check if it is a separator 
+  //
+  return isspace(c) || c == '\0' || strchr(",.()+-/*=~%<>[];", c) != NULL;
+}
+
+void editorUpdateSyntax(erow *row) {
+
+  // panes showing the row need drawing again
+  //
+  editorPanesTouch(row->idx, row->idx);
+  editorRowFill(row);
+
+  // allocate memory for the row highlights
+  //
+  row->hl = realloc(row->hl, row->rsize);
+
+  // if there is no syntax in the row
+  // set the whole row to normal and return
+  //
+  if (E.syntax == NULL) {
+    memset(row->hl, HL_NORMAL, row->rsize);
+    editorParseClear(row);
+    editorBracketUpdateRow(row);
+    return;
+  }
+
+  // keep track of if we are in a ml comment
+  //
+  int in_comment = (row->idx > 0 && E.row[row->idx - 1].hl_open_comment);
+
+  // while a file is loading show the row plain
+  // and let the background highlighter color it,
+  // or whoever holds it back once it is done
+  //
+  if (E.hl_hold || (E.hl_defer && E.hlworker.running)) {
+    memset(row->hl, HL_NORMAL, row->rsize);
+    editorParseClear(row);
+    editorBracketUpdateRow(row);
+    editorHighlightInvalidate(row->idx);
+    return;
+  }
+
+  // run the lexer over the row
+  //
+  row->hl_done = HL_KEY(row->hlver, in_comment);
+  in_comment = editorLexLine(E.syntax->lexer, row->render, row->rsize, row->hl, in_comment);
+
+  // highlighting of next line won't change if
+  // not in a comment
+  //
+  int changed = (row->hl_open_comment != in_comment);
+  
+  // set open comment to current state of comment
+  //
+  row->hl_open_comment = in_comment;
+
+  // find the structure and the brackets in
+  // the new highlighting
+  //
+  editorParseRows(row, 1);
+  editorBracketUpdateRow(row);
+
+  // if it is changed and within the file
+  // then update syntax of the row after
+  // the background highlighter carries it down
+  // the file when it is running
+  //
+  if (changed && row->idx + 1 < E.numrows) {
+    if (E.hlworker.running) {
+      editorHighlightInvalidate(row->idx + 1);
+    }
+    else {
+      editorUpdateSyntax(&E.row[row->idx + 1]);
+    }
+  }
+}
+
+void editorLexerCompile(struct editorSyntax *syntax) {
+
+  // allocate the tables
+  //
+  struct editorLexer *lx = calloc(1, sizeof(struct editorLexer));
+  int numbers = syntax->flags & HL_HIGHLIGHT_NUMBERS;
+  int strings = syntax->flags & HL_HIGHLIGHT_STRINGS;
+
+  // give every byte the class the old chain of checks
+  // would have treated it as
+  //
+  for (int c = 0; c < 256; c++) {
+    int cls = is_separator(c) ? LC_SEP : LC_OTHER;
+    if (numbers && isdigit(c)) {
+      cls = LC_DIGIT;
+    }
+    else if (numbers && c == '.') {
+      cls = LC_DOT;
+    }
+    if (strings && (c == '"' || c == '\'')) {
+      cls = LC_QUOTE;
+    }
+    lx->cls[c] = cls;
+    lx->base[c] = cls;
+  }
+
+  // bytes that may start a comment only get compared
+  // against the delimiters when they show up
+  //
+  char *scs = syntax->singleline_comment_start;
+  char *mcs = syntax->multiline_comment_start;
+  char *mce = syntax->multiline_comment_end;
+  if (scs && scs[0]) {
+    lx->scs = scs;
+    lx->scs_len = strlen(scs);
+    lx->cls[(unsigned char)scs[0]] = LC_DELIM;
+  }
+  if (mcs && mcs[0] && mce && mce[0]) {
+    lx->mcs = mcs;
+    lx->mcs_len = strlen(mcs);
+    lx->mce = mce;
+    lx->mce_len = strlen(mce);
+    lx->cls[(unsigned char)mcs[0]] = LC_DELIM;
+  }
+  lx->syntax = syntax;
+  syntax->lexer = lx;
+}
+
+int editorLexLine(const struct editorLexer *lx, const char *render, int rsize, unsigned char *hl, int in_comment) {
+
+  // start where the previous row left off
+  //
+  int state = in_comment ? LS_MLCOMMENT : LS_SEP;
+  int i = 0;
+
+  // classify one byte per step
+  //
+  while (i < rsize) {
+
+    // skip straight to the end of a multiline comment
+    //
+    if (state == LS_MLCOMMENT) {
+      char *end = memmem(&render[i], rsize - i, lx->mce, lx->mce_len);
+      int stop = end ? (end - render) + lx->mce_len : rsize;
+      memset(&hl[i], HL_MLCOMMENT, stop - i);
+      i = stop;
+      if (end) {
+        state = LS_SEP;
+      }
+      continue;
+    }
+
+    // look up the class of the byte
+    //
+    unsigned char c = render[i];
+    int cls = lx->cls[c];
+
+    // the byte may start a comment
+    //
+    if (cls == LC_DELIM) {
+      if (lx->scs_len && !strncmp(&render[i], lx->scs, lx->scs_len)) {
+        memset(&hl[i], HL_COMMENT, rsize - i);
+        break;
+      }
+      if (lx->mcs_len && !strncmp(&render[i], lx->mcs, lx->mcs_len)) {
+        memset(&hl[i], HL_MLCOMMENT, lx->mcs_len);
+        i += lx->mcs_len;
+        state = LS_MLCOMMENT;
+        continue;
+      }
+      cls = lx->base[c];
+    }
+
+    // most bytes only need the transition table
+    //
+    unsigned char t = editorLexTable[state][cls];
+    int next = t & 0x0f;
+    if (next < LS_ACTIONS) {
+      hl[i++] = t >> 4;
+      state = next;
+      continue;
+    }
+
+    // a string runs to the next matching quote
+    //
+    if (next == LA_STRING) {
+      char *end = memchr(&render[i + 1], c, rsize - i - 1);
+      int stop = end ? (end - render) + 1 : rsize;
+      memset(&hl[i], HL_STRING, stop - i);
+      i = stop;
+      state = LS_SEP;
+      continue;
+    }
+
+    // otherwise a word starts after a separator
+    // so look the whole word up
+    //
+    int klen = 1;
+    while (i + klen < rsize && lx->base[(unsigned char)render[i + klen]] != LC_SEP && lx->base[(unsigned char)render[i + klen]] != LC_DOT) {
+      klen++;
+    }
+    int kind = editorSyntaxKeyword(lx->syntax, &render[i], klen);
+    if (kind) {
+      memset(&hl[i], kind, klen);
+      i += klen;
+    }
+    else {
+      hl[i++] = HL_NORMAL;
+    }
+    state = LS_WORD;
+  }
+
+  // tell the caller whether the row ends
+  // inside a comment
+  //
+  return state == LS_MLCOMMENT;
+}
+
+// the row lexer the tables replaced, kept to check
+// them against and time them with
+//
+#ifdef KILO_BENCH
+int editorHighlightBranchy(struct editorSyntax *syntax, const char *render, int rsize, unsigned char *hl, int in_comment) {
+
+  // set the whole row to normal
+  //
+  memset(hl, HL_NORMAL, rsize);
+
+  // keep track of single line comment start
+  //
+  char *scs = syntax->singleline_comment_start;
+
+  // multiline comments start and end
+  //
+  char *mcs = syntax->multiline_comment_start;
+  char *mce = syntax->multiline_comment_end;
+
+  // length of single line comment
+  //
+  int scs_len = scs ? strlen(scs) : 0;
+  
+  // length of multiline comments
+  //
+  int mcs_len = mcs ? strlen(mcs) : 0;
+  int mce_len = mce ? strlen(mce) : 0;
+
+  // keep track of separator characters
+  //
+  int prev_sep = 1;
+  
+  // keep track of if we are in a string
+  //
+  int in_string = 0;
+  
+  // index variable
+  //
+  int i = 0;
+
+  // iterate through the whole row
+  //
+  while (i < rsize) {
+
+    // load in the specific character
+    //
+    char c = render[i];
+    
+    // previous character
+    //
+    unsigned char prev_hl = (i > 0) ? hl[i - 1] : HL_NORMAL;
+
+    // if this is a single line comment
+    //
+    if (scs_len && !in_string && !in_comment) {
+
+      // if thi is not the beginning of the row
+      //
+      if (!strncmp(&render[i], scs, scs_len)) {
+        memset(&hl[i], HL_COMMENT, rsize - i);
+        break;
+      }
+    }
+
+    // if all proper flags are one and we aren't in a string
+    //
+    if (mcs_len && mce_len && !in_string) {
+
+      // if we are within a comment
+      //
+      if (in_comment) {
+
+        // set the character to a multiline comment
+        hl[i] = HL_MLCOMMENT;
+
+        // check if at end of multiline comment
+        //
+        if (!strncmp(&render[i], mce, mce_len)) {
+
+          // if not highlight the whole comment 
+          //
+          memset(&hl[i], HL_MLCOMMENT, mce_len);
+          i += mce_len;
+          in_comment = 0;
+          prev_sep = 1;
+          continue;
+        } 
+        
+        else {
+          i++;
+          continue;
+        }
+      }
+
+      // check if we are at the beginning of a comment
+      // 
+      else if (!strncmp(&render[i], mcs, mcs_len)) {
+
+        // if so set the comment to the appropriate color
+        //
+        memset(&hl[i], HL_MLCOMMENT, mcs_len);
+        i += mcs_len;
+        in_comment = 1;
+        continue;
+      }
+    }
+
+    // if the syntax flag is on highlihgt strings
+    //
+    if (syntax->flags & HL_HIGHLIGHT_STRINGS) {
+
+      // if currently in a string
+      //
+      if (in_string) {
+
+        // highlight the character
+        //
+        hl[i] = HL_STRING;
+
+        // if character is the closing quote
+        // note exit string
+        //
+        if (c == in_string) {
+          in_string = 0;
+        }
+
+        // increment
+        //
+        i++;
+
+        // note that this is a separation character
+        prev_sep = 1;
+        continue;
+      } 
+
+      // if is single or double quote
+      //
+      else {
+        if (c == '"' || c == '\'') {
+
+          // set the end quote
+          //
+          in_string = c;
+
+          // highlihgt as part of string
+          //
+          hl[i] = HL_STRING;
+
+          // incremenet
+          //
+          i++;
+          continue;
+        }
+      }
+    }
+    
+    // if the syntax flag is on and highlighting numbers flag is on
+    //
+    if (syntax->flags & HL_HIGHLIGHT_NUMBERS) {
+
+      // if it is a number/. and the previous HL is a number, separator, period
+      //
+      if ((isdigit(c) && (prev_sep || prev_hl == HL_NUMBER)) || (c == '.' && prev_hl == HL_NUMBER)) {
+
+        // make the current character a number
+        //
+        hl[i] = HL_NUMBER;
+
+        // incriment i
+        //
+        i++;
+
+        // reset separator
+        //
+        prev_sep = 0;
+        continue;
+      }
+    }
+
+
+    // if prevous word was a separator
+    //
+    if (prev_sep) {
+
+      // find the end of the word
+      //
+      int klen = 0;
+      while (i + klen < rsize && !is_separator(render[i + klen])) {
+        klen++;
+      }
+
+      // look the whole word up in the keyword table
+      //
+      int kind = editorSyntaxKeyword(syntax, &render[i], klen);
+      if (kind) {
+
+        // set the memory of the highlight appropriately
+        // and increment by the keyword length
+        //
+        memset(&hl[i], kind, klen);
+        i += klen;
+        prev_sep = 0;
+        continue;
+      }
+    }
+
+    // check if the chracter is a separator
+    //
+    prev_sep = is_separator(c);
+    
+    // incriment
+    //
+    i++;
+  }
+
+  // tell the caller whether the row ends
+  // inside a comment
+  //
+  return in_comment;
+}
+
+void editorBenchSyntax(char *filename) {
+
+  // load the file without a terminal
+  //
+  E.filename = strdup(filename);
+  editorSelectSyntaxHighlight();
+  if (E.syntax == NULL) {
+    fprintf(stderr, "no syntax for %s\n", filename);
+    exit(1);
+  }
+  FILE *fp = fopen(filename, "r");
+  if (!fp) {
+    die("fopen");
+  }
+  char *line = NULL;
+  size_t linecap = 0;
+  ssize_t linelen;
+  while ((linelen = getline(&line, &linecap, fp)) != -1) {
+    while (linelen > 0 && (line[linelen - 1] == '\n' || line[linelen - 1] == '\r')) {
+      linelen--;
+    }
+    editorInsertRow(E.numrows, line, linelen);
+  }
+  free(line);
+  fclose(fp);
+
+  // total bytes highlighted per pass
+  //
+  long long bytes = 0;
+  for (int j = 0; j < E.numrows; j++) {
+    bytes += E.row[j].rsize;
+  }
+
+  // check both lexers agree on every row
+  //
+  unsigned char *hl = NULL;
+  int cap = 0;
+  int in_a = 0;
+  int in_b = 0;
+  int mismatches = 0;
+  for (int j = 0; j < E.numrows; j++) {
+    erow *row = &E.row[j];
+    if (row->rsize > cap) {
+      cap = row->rsize;
+      hl = realloc(hl, cap);
+    }
+    in_a = editorHighlightBranchy(E.syntax, row->render, row->rsize, hl, in_a);
+    in_b = editorLexLine(E.syntax->lexer, row->render, row->rsize, row->hl, in_b);
+    if (in_a != in_b || memcmp(hl, row->hl, row->rsize)) {
+      mismatches++;
+    }
+  }
+
+  // time enough passes of each to get past a second of work
+  //
+  for (int which = 0; which < 2; which++) {
+    struct timespec start, end;
+    double secs = 0;
+    int passes = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (secs < 1.0) {
+      int in_comment = 0;
+      for (int j = 0; j < E.numrows; j++) {
+        erow *row = &E.row[j];
+        if (which == 0) {
+          in_comment = editorHighlightBranchy(E.syntax, row->render, row->rsize, hl, in_comment);
+        }
+        else {
+          in_comment = editorLexLine(E.syntax->lexer, row->render, row->rsize, row->hl, in_comment);
+        }
+      }
+      passes++;
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    }
+    printf("%-8s %8.1f MB/s (%d passes over %lld bytes)\n", which == 0 ? "branchy" : "table", bytes * passes / secs / 1e6, passes, bytes);
+  }
+  printf("rows that differ: %d of %d\n", mismatches, E.numrows);
+  free(hl);
+  exit(mismatches ? 1 : 0);
+}
+#endif
+
+int editorSyntaxToColor(int hl) {
+
+  // switch case with the numbers correlating
+  // to the appropriate colors
+  //
+  switch (hl) {
+    case HL_COMMENT:
+    case HL_MLCOMMENT: return 36;
+    case HL_KEYWORD1: return 33;
+    case HL_KEYWORD2: return 32;
+    case HL_STRING: return 35;
+    case HL_NUMBER: return 31;
+    case HL_MATCH: return 34;
+    case HL_TYPE: return 32;
+    case HL_FUNCTION: return 94;
+    case HL_MACRO: return 95;
+    case HL_PREPROC: return 96;
+    default: return 37;
+  }
+}
+
+/* End Syntax Actions */
+
+/* Background Highlighting */
+
+void *editorHighlightWorker(void *arg) {
+  struct editorHighlighter *w = arg;
+
+  // the row finished last from each queue, the row after it
+  // starts in the state it ended in, which beats the guess it
+  // was queued with when rows are handed out faster than
+  // they come back
+  //
+  struct editorSyntax *last_syntax[2] = {NULL, NULL};
+  int last_idx[2] = {-1, -1};
+  int last_out[2] = {0, 0};
+
+  while (1) {
+
+    // wait for a row, rows on the screen first
+    //
+    pthread_mutex_lock(&w->lock);
+    while (w->urgent == NULL && w->jobs == NULL) {
+      pthread_cond_wait(&w->wake, &w->lock);
+    }
+    struct editorHighlightJob *job;
+    if (w->urgent) {
+      job = w->urgent;
+      w->urgent = job->next;
+    }
+    else {
+      job = w->jobs;
+      w->jobs = job->next;
+    }
+    pthread_mutex_unlock(&w->lock);
+
+    // lex the copy of the row, nothing here touches
+    // the rows of the editor
+    //
+    int q = job->urgent;
+    if (job->syntax == last_syntax[q] && job->idx == last_idx[q] + 1) {
+      job->in = last_out[q];
+    }
+    job->hl = malloc(job->rsize ? job->rsize : 1);
+    job->out = editorLexLine(job->syntax->lexer, job->render, job->rsize, job->hl, job->in);
+    last_syntax[q] = job->syntax;
+    last_idx[q] = job->idx;
+    last_out[q] = job->out;
+    free(job->render);
+    job->render = NULL;
+
+    // hand it back and wake the input loop if
+    // it has nothing else waiting
+    //
+    job->next = NULL;
+    pthread_mutex_lock(&w->lock);
+    int wake = (w->done == NULL);
+    if (w->done) {
+      w->done_tail->next = job;
+    }
+    else {
+      w->done = job;
+    }
+    w->done_tail = job;
+    pthread_mutex_unlock(&w->lock);
+    if (wake) {
+      write(w->pipe[1], "h", 1);
+    }
+  }
+  return NULL;
+}
+
+void editorHighlightStart() {
+  struct editorHighlighter *w = &E.hlworker;
+
+  // the pipe never blocks the worker, a full pipe already
+  // means the input loop will wake up
+  //
+  if (pipe(w->pipe) == -1) {
+    return;
+  }
+  fcntl(w->pipe[0], F_SETFL, O_NONBLOCK);
+  fcntl(w->pipe[1], F_SETFL, O_NONBLOCK);
+
+  // without a thread everything stays synchronous
+  //
+  pthread_mutex_init(&w->lock, NULL);
+  pthread_cond_init(&w->wake, NULL);
+  if (pthread_create(&w->thread, NULL, editorHighlightWorker, w) != 0) {
+    close(w->pipe[0]);
+    close(w->pipe[1]);
+    return;
+  }
+  w->running = 1;
+}
+
+void editorHighlightInvalidate(int at) {
+
+  // rows from at down have to be checked again
+  //
+  if (at < E.hl_frontier) {
+    E.hl_frontier = at;
+  }
+  if (at < E.hl_ahead) {
+    E.hl_ahead = at;
+  }
+}
+
+int editorHighlightSubmit(int at, int urgent, int force) {
+  struct editorHighlighter *w = &E.hlworker;
+  erow *row = &E.row[at];
+  editorRowFill(row);
+
+  // the row starts in whatever state the row above
+  // ends in at the moment, if that changes later the
+  // row is simply done again
+  //
+  int in = (at > 0 && E.row[at - 1].hl_open_comment);
+  unsigned long key = HL_KEY(row->hlver, in);
+
+  // nothing to do if it is done or on its way, unless the
+  // row above is still on its way and this one has to follow
+  // it so the worker starts it where that one ends
+  //
+  if (!force && (row->hl_done == key || row->hl_queued == key)) {
+    return 0;
+  }
+
+  // copy the row so it can change while the worker
+  // is busy with it, the terminator comes along for
+  // the comment compares
+  //
+  struct editorHighlightJob *job = malloc(sizeof(struct editorHighlightJob));
+  job->next = NULL;
+  job->syntax = E.syntax;
+  job->buf = E.curbuf;
+  job->idx = at;
+  job->urgent = urgent;
+  job->ver = row->hlver;
+  job->in = in;
+  job->queued = key;
+  job->out = 0;
+  job->rsize = row->rsize;
+  job->render = malloc(row->rsize + 1);
+  memcpy(job->render, row->render, row->rsize + 1);
+  job->hl = NULL;
+  row->hl_queued = key;
+  if (!urgent) {
+    w->pending++;
+  }
+
+  // queue it and wake the worker
+  //
+  pthread_mutex_lock(&w->lock);
+  struct editorHighlightJob **head = urgent ? &w->urgent : &w->jobs;
+  struct editorHighlightJob **tail = urgent ? &w->urgent_tail : &w->jobs_tail;
+  if (*head) {
+    (*tail)->next = job;
+  }
+  else {
+    *head = job;
+  }
+  *tail = job;
+  pthread_cond_signal(&w->wake);
+  pthread_mutex_unlock(&w->lock);
+  return 1;
+}
+
+void editorHighlightSchedule() {
+  if (!E.hlworker.running || E.syntax == NULL) {
+    return;
+  }
+
+  // rows on the screen go first
+  //
+  for (int i = 0; i < E.numpanes; i++) {
+    int rowoff = (i == E.curpane) ? E.rowoff : E.panes[i].rowoff;
+    int sub;
+    int first = editorLayoutRowOfLine(rowoff, &sub);
+    for (int r = first; r < first + E.panes[i].rows && r < E.numrows; r++) {
+      editorHighlightSubmit(r, 1, 0);
+    }
+  }
+
+  // move the frontier past every row whose highlight
+  // started in the state the row above ends in
+  //
+  while (E.hl_frontier < E.numrows) {
+    erow *row = &E.row[E.hl_frontier];
+    int in = (E.hl_frontier > 0 && E.row[E.hl_frontier - 1].hl_open_comment);
+    if (row->hl_done != HL_KEY(row->hlver, in)) {
+      break;
+    }
+    E.hl_frontier++;
+  }
+
+  // the frontier row is known to start in the right state,
+  // once nothing is on its way for it start handing out rows
+  // from there again, every row that follows one still on
+  // its way goes along so the worker redoes the whole run
+  //
+  if (E.hl_frontier < E.numrows && E.row[E.hl_frontier].hl_queued == 0) {
+    E.hl_ahead = E.hl_frontier;
+  }
+  if (E.hl_ahead < E.hl_frontier) {
+    E.hl_ahead = E.hl_frontier;
+  }
+  while (E.hl_ahead < E.numrows && E.hlworker.pending < KILO_HL_BATCH) {
+    int r = E.hl_ahead++;
+    editorHighlightSubmit(r, 0, r > 0 && E.row[r - 1].hl_queued != 0);
+  }
+}
+
+int editorHighlightPoll() {
+  struct editorHighlighter *w = &E.hlworker;
+  if (!w->running) {
+    return 0;
+  }
+
+  // empty the pipe and take every finished row
+  //
+  char buf[64];
+  while (read(w->pipe[0], buf, sizeof(buf)) > 0);
+  pthread_mutex_lock(&w->lock);
+  struct editorHighlightJob *job = w->done;
+  w->done = NULL;
+  pthread_mutex_unlock(&w->lock);
+
+  int applied = 0;
+  while (job) {
+    struct editorHighlightJob *next = job->next;
+    if (!job->urgent) {
+      w->pending--;
+    }
+
+    // a row that changed since it was copied has a newer
+    // version, or is gone, and the result is thrown away
+    //
+    if (job->buf == E.curbuf && job->syntax == E.syntax && job->idx < E.numrows && E.row[job->idx].hlver == job->ver) {
+      erow *row = &E.row[job->idx];
+
+      // the worker may have started it in another state
+      // than it was queued with, either way it can be
+      // queued again if that turns out wrong
+      //
+      if (row->hl_queued == job->queued) {
+        row->hl_queued = 0;
+      }
+      free(row->hl);
+      row->hl = job->hl;
+      job->hl = NULL;
+      row->hl_done = HL_KEY(job->ver, job->in);
+
+      // a comment opening or closing changes every
+      // row after it
+      //
+      if (row->hl_open_comment != job->out) {
+        row->hl_open_comment = job->out;
+        editorHighlightInvalidate(job->idx + 1);
+      }
+      editorPanesTouch(job->idx, job->idx);
+      editorParseRows(row, 1);
+      editorBracketUpdateRow(row);
+      applied++;
+    }
+
+    // otherwise whatever row is there now is not waiting
+    // for it, the row it was for is queued again when the
+    // frontier gets to it, in the buffer it came from even
+    // if that is not the one shown
+    //
+    else {
+      int numrows = E.numrows;
+      erow *rows = E.row;
+      if (job->buf != E.curbuf && job->buf < E.numbuffers) {
+        numrows = E.buffers[job->buf].numrows;
+        rows = E.buffers[job->buf].row;
+      }
+      if (job->idx < numrows && rows[job->idx].hl_queued == job->queued) {
+        rows[job->idx].hl_queued = 0;
+      }
+    }
+    free(job->hl);
+    free(job);
+    job = next;
+  }
+  return applied;
+}
+
+int editorHighlightStale() {
+
+  // rows whose colors are not for what they hold
+  // and the state the row above ends in
+  //
+  int stale = 0;
+  for (int j = 0; j < E.numrows; j++) {
+    int in = (j > 0 && E.row[j - 1].hl_open_comment);
+    if (E.row[j].hl_done != HL_KEY(E.row[j].hlver, in)) {
+      stale++;
+    }
+  }
+  return stale;
+}
+
+void editorHighlightSettle(int timeout) {
+  struct editorHighlighter *w = &E.hlworker;
+  if (!w->running || E.syntax == NULL) {
+    return;
+  }
+
+  // keep handing out rows and taking them back until the
+  // frontier reaches the end, or nothing comes back for
+  // timeout milliseconds
+  //
+  while (1) {
+    editorHighlightSchedule();
+    if (E.hl_frontier >= E.numrows) {
+      return;
+    }
+    struct pollfd fd = {w->pipe[0], POLLIN, 0};
+    if (poll(&fd, 1, timeout) <= 0) {
+      return;
+    }
+    editorHighlightPoll();
+  }
+}
+
+/* End Background Highlighting */
+
+
+
+/* Event Loop */
+
+void editorEventsStart() {
+
+  // resizes come in as reads on a descriptor, the signal
+  // is blocked before any thread starts so none of them
+  // takes it instead
+  //
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGWINCH);
+  if (sigprocmask(SIG_BLOCK, &mask, NULL) == 0) {
+    E.events.signal = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  }
+
+  // a timer goes off when the status message expires
+  //
+  E.events.timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+}
+
+int editorEventsWait(int timeout) {
+  struct editorHighlighter *w = &E.hlworker;
+
+  // a scripted key is always ready, rows the worker
+  // finished in the meantime are taken first
+  //
+  if (E.term->fd < 0) {
+    editorHighlightPoll();
+    return 1;
+  }
+
+  // sleep until a key comes in, putting highlighting on the
+  // screen whenever the worker finishes some, rows whenever
+  // a followed file grows, files that changed on disk, the
+  // screen at its new size and the message bar once the
+  // message expires, nothing wakes up in between, with a
+  // timeout in milliseconds 0 is returned once it is up
+  //
+  long long deadline = editorStatsClock() + timeout * 1000000LL;
+  while (1) {
+    struct pollfd fds[6];
+    int nfds = 0;
+    int term = nfds++;
+    fds[term].fd = E.term->fd;
+    int hl = -1, follow = -1, watch = -1, timer = -1, sig = -1;
+    if (w->running) {
+      hl = nfds++;
+      fds[hl].fd = w->pipe[0];
+    }
+    if (E.follow.active) {
+      follow = nfds++;
+      fds[follow].fd = E.follow.watch;
+    }
+    if (E.watch >= 0) {
+      watch = nfds++;
+      fds[watch].fd = E.watch;
+    }
+    if (E.events.timer >= 0) {
+      timer = nfds++;
+      fds[timer].fd = E.events.timer;
+    }
+    if (E.events.signal >= 0) {
+      sig = nfds++;
+      fds[sig].fd = E.events.signal;
+    }
+    for (int i = 0; i < nfds; i++) {
+      fds[i].events = POLLIN;
+      fds[i].revents = 0;
+    }
+    int wait = -1;
+    if (timeout >= 0) {
+      long long left = deadline - editorStatsClock();
+      wait = left > 0 ? (int)((left + 999999) / 1000000) : 0;
+    }
+    int ready = poll(fds, nfds, wait);
+    if (ready == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      die("poll");
+    }
+    if (ready == 0) {
+      return 0;
+    }
+    if (sig >= 0 && fds[sig].revents) {
+      struct signalfd_siginfo info;
+      while (read(E.events.signal, &info, sizeof(info)) == sizeof(info));
+      editorResize();
+      editorRefreshScreen();
+    }
+    if (hl >= 0 && fds[hl].revents && editorHighlightPoll()) {
+      editorRefreshScreen();
+    }
+    if (follow >= 0 && fds[follow].revents && editorFollowRead()) {
+      editorRefreshScreen();
+    }
+    if (watch >= 0 && fds[watch].revents) {
+      editorDiskPoll();
+      editorRefreshScreen();
+    }
+    if (timer >= 0 && fds[timer].revents) {
+      uint64_t expired;
+      read(E.events.timer, &expired, sizeof(expired));
+      editorRefreshScreen();
+    }
+    if (fds[term].revents) {
+      return 1;
+    }
+  }
+}
+
+void editorEventsTimer() {
+
+  // wake up when the message just set stops showing
+  //
+  if (E.events.timer < 0) {
+    return;
+  }
+  struct itimerspec when;
+  memset(&when, 0, sizeof(when));
+  when.it_value.tv_sec = 5;
+  timerfd_settime(E.events.timer, 0, &when, NULL);
+}
+
+void editorResize() {
+
+  // nothing to do when the size did not change,
+  // a drag sends a stream of these
+  //
+  int rows, cols;
+  if (E.term->size(&rows, &cols) == -1 || rows < 3 || cols < 1) {
+    return;
+  }
+  rows -= 2;
+  if (rows == E.termrows && cols == E.termcols) {
+    return;
+  }
+
+  // rowoff counts visual lines while wrapping, remember
+  // the row at the top of every pane while the layout
+  // still matches the old width
+  //
+  struct editorPane old[2];
+  int tops[2];
+  int sub;
+  editorPaneStash(&E.panes[E.curpane]);
+  for (int i = 0; i < E.numpanes; i++) {
+    editorPaneLoad(&E.panes[i]);
+    tops[i] = editorLayoutRowOfLine(E.rowoff, &sub);
+    old[i] = E.panes[i];
+  }
+
+  // lay the panes out at the new size
+  //
+  int shorter = rows < E.termrows;
+  E.termrows = rows;
+  E.termcols = cols;
+  editorPanesLayout();
+
+  // a pane that kept its place and size keeps what it
+  // shows unless the screen got shorter, terminals scroll
+  // the lines below the cursor away when shrinking
+  //
+  for (int i = 0; i < E.numpanes; i++) {
+    struct editorPane *p = &E.panes[i];
+    if (!shorter && p->top == old[i].top && p->left == old[i].left && p->rows == old[i].rows && p->cols == old[i].cols) {
+      p->drawn = old[i].drawn;
+    }
+
+    // the same row goes back at the top, the layout is
+    // only built again for the new width when wrapping
+    // needs it
+    //
+    if (E.wrap && p->cols != old[i].cols) {
+      editorPaneLoad(p);
+      E.rowoff = editorLayoutLineOfRow(tops[i]);
+      editorPaneStash(p);
+    }
+  }
+  editorPaneLoad(&E.panes[E.curpane]);
+}
+
+/* End Event Loop */
+
+/* Structure Parsing */
+
+int editorSymbolFind(const char *s, int len, int create) {
+  struct editorSymbols *t = &E.symbols;
+
+  // look the name up
+  //
+  uint32_t hash = editorSyntaxHash(s, len);
+  uint32_t slot = hash;
+  if (t->table) {
+    for (;; slot++) {
+      int i = t->table[slot & t->mask];
+      if (i < 0) {
+        break;
+      }
+      struct editorSymbol *sym = &t->syms[i];
+      if (sym->hash == hash && sym->len == len && !memcmp(sym->name, s, len)) {
+        return i;
+      }
+    }
+  }
+  if (!create) {
+    return -1;
+  }
+
+  // keep the table at most half full
+  //
+  if (t->table == NULL || (uint32_t)(t->n + 1) * 2 > t->mask + 1) {
+    uint32_t size = t->table ? (t->mask + 1) * 2 : 256;
+    free(t->table);
+    t->table = malloc(sizeof(int) * size);
+    t->mask = size - 1;
+    memset(t->table, -1, sizeof(int) * size);
+    for (int i = 0; i < t->n; i++) {
+      uint32_t k = t->syms[i].hash;
+      while (t->table[k & t->mask] >= 0) {
+        k++;
+      }
+      t->table[k & t->mask] = i;
+    }
+    slot = hash;
+    while (t->table[slot & t->mask] >= 0) {
+      slot++;
+    }
+  }
+
+  // add it
+  //
+  if (t->n == t->cap) {
+    t->cap = t->cap ? t->cap * 2 : 64;
+    t->syms = realloc(t->syms, sizeof(struct editorSymbol) * t->cap);
+  }
+  struct editorSymbol *sym = &t->syms[t->n];
+  sym->name = malloc(len);
+  memcpy(sym->name, s, len);
+  sym->len = len;
+  sym->hash = hash;
+  sym->macros = 0;
+  sym->types = 0;
+  t->table[slot & t->mask] = t->n;
+  return t->n++;
+}
+
+void editorSymbolRef(int def, int delta) {
+
+  // a definition is the index of the symbol with
+  // the low bit set for a type
+  //
+  struct editorSymbol *sym = &E.symbols.syms[def >> 1];
+  int *count = (def & 1) ? &sym->types : &sym->macros;
+  int was = (*count > 0);
+  *count += delta;
+
+  // rows anywhere may use the name
+  //
+  if ((*count > 0) != was) {
+    editorPanesTouch(0, INT_MAX);
+  }
+}
+
+void editorSymbolsFree(struct editorSymbols *t) {
+  for (int i = 0; i < t->n; i++) {
+    free(t->syms[i].name);
+  }
+  free(t->syms);
+  free(t->table);
+  memset(t, 0, sizeof(struct editorSymbols));
+}
+
+void editorParseClear(erow *row) {
+
+  // drop the names the row defined
+  //
+  for (int i = 0; i < row->ndefs; i++) {
+    editorSymbolRef(row->defs[i], -1);
+  }
+  free(row->defs);
+  free(row->nodes);
+  row->defs = NULL;
+  row->ndefs = 0;
+  row->nodes = NULL;
+  row->nnodes = 0;
+}
+
+int editorParseLine(erow *row, int in) {
+
+  // nodes are collected here and copied to the row
+  //
+  static struct editorNode *nodes = NULL;
+  static int cap = 0;
+  int n = 0;
+
+  editorParseClear(row);
+  row->ps_in = in;
+  if (E.syntax == NULL || !(E.syntax->flags & HL_HIGHLIGHT_STRUCTURE) || row->hl == NULL) {
+    row->ps_out = 0;
+    return 0;
+  }
+
+  char *s = row->render;
+  unsigned char *hl = row->hl;
+  int size = row->rsize;
+  if (cap < size + 1) {
+    cap = size + 1;
+    nodes = realloc(nodes, sizeof(struct editorNode) * cap);
+  }
+
+  // pp is set within a preprocessor line, define when the
+  // next name is the one being defined
+  // a typedef is named by the last name at depth zero before
+  // its semicolon, or by the one in (*name) when it is a
+  // pointer to a function
+  //
+  int pp = in & PS_CONTINUE;
+  int define = 0;
+  int typedefs = in & PS_TYPEDEF;
+  int depth = in >> PS_DEPTH_SHIFT;
+  int name = -1;
+  int namelen = 0;
+  int locked = 0;
+
+  // a directive has the # first on the row
+  //
+  int i = 0;
+  while (i < size && isspace(s[i])) {
+    i++;
+  }
+  if (!pp && i < size && s[i] == '#' && hl[i] != HL_COMMENT && hl[i] != HL_MLCOMMENT) {
+    int start = i++;
+    while (i < size && isspace(s[i])) {
+      i++;
+    }
+    int word = i;
+    while (i < size && (isalnum(s[i]) || s[i] == '_')) {
+      i++;
+    }
+    nodes[n++] = (struct editorNode){start, i - start, NODE_PREPROC};
+    define = (i - word == 6 && !strncmp(&s[word], "define", 6));
+    pp = 1;
+  }
+
+  for (; i < size; i++) {
+
+    // strings, comments and numbers hold no structure
+    //
+    if (hl[i] != HL_NORMAL && hl[i] != HL_KEYWORD1 && hl[i] != HL_KEYWORD2) {
+      continue;
+    }
+
+    if (isalpha(s[i]) || s[i] == '_') {
+      int start = i;
+      while (i + 1 < size && (isalnum(s[i + 1]) || s[i + 1] == '_')) {
+        i++;
+      }
+      int len = i - start + 1;
+      if (!pp && len == 7 && !strncmp(&s[start], "typedef", 7)) {
+        typedefs = 1;
+        depth = 0;
+        name = -1;
+        locked = 0;
+        continue;
+      }
+
+      // keywords are already colored
+      //
+      if (hl[start] != HL_NORMAL) {
+        continue;
+      }
+
+      // the name after #define is a macro
+      //
+      if (define) {
+        int def = editorSymbolFind(&s[start], len, 1) << 1;
+        row->defs = realloc(row->defs, sizeof(int) * (row->ndefs + 1));
+        row->defs[row->ndefs++] = def;
+        editorSymbolRef(def, 1);
+        nodes[n++] = (struct editorNode){start, len, NODE_NAME};
+        define = 0;
+        continue;
+      }
+
+      // a name followed by a parenthesis is called
+      //
+      int j = i + 1;
+      while (j < size && s[j] == ' ') {
+        j++;
+      }
+      nodes[n++] = (struct editorNode){start, len, (j < size && s[j] == '(') ? NODE_CALL : NODE_NAME};
+
+      // remember what may name the typedef
+      //
+      if (typedefs && depth == 0 && !locked) {
+        int k = start - 1;
+        while (k >= 0 && s[k] == ' ') {
+          k--;
+        }
+        if (k >= 0 && s[k] == '*') {
+          k--;
+          while (k >= 0 && s[k] == ' ') {
+            k--;
+          }
+          locked = (k >= 0 && s[k] == '(');
+        }
+        name = start;
+        namelen = len;
+      }
+      continue;
+    }
+
+    // follow the braces of a typedef to its semicolon
+    //
+    if (typedefs && !pp) {
+      if (s[i] == '{') {
+        depth++;
+      }
+      else if (s[i] == '}' && depth > 0) {
+        depth--;
+      }
+      else if (s[i] == ';' && depth == 0) {
+        if (name >= 0) {
+          int def = editorSymbolFind(&s[name], namelen, 1) << 1 | 1;
+          row->defs = realloc(row->defs, sizeof(int) * (row->ndefs + 1));
+          row->defs[row->ndefs++] = def;
+          editorSymbolRef(def, 1);
+        }
+        typedefs = 0;
+        name = -1;
+        locked = 0;
+      }
+    }
+  }
+
+  // keep the nodes
+  //
+  if (n) {
+    row->nodes = malloc(sizeof(struct editorNode) * n);
+    memcpy(row->nodes, nodes, sizeof(struct editorNode) * n);
+    row->nnodes = n;
+  }
+
+  // a backslash carries the directive on to the next row
+  //
+  int out = 0;
+  if (pp && size > 0 && s[size - 1] == '\\') {
+    out |= PS_CONTINUE;
+  }
+  if (typedefs) {
+    out |= PS_TYPEDEF | (depth < (1 << 20) ? depth : (1 << 20)) << PS_DEPTH_SHIFT;
+  }
+  row->ps_out = out;
+  return out;
+}
+
+void editorParseRows(erow *row, int force) {
+
+  // rows that were never highlighted are parsed
+  // when their highlighting comes in
+  //
+  int at = row->idx;
+  if (!force && (row->hl_done == 0 || row->ps_in == (at > 0 ? E.row[at - 1].ps_out : 0))) {
+    return;
+  }
+
+  // parse the row and every row after it that
+  // starts in another state than it was parsed in
+  //
+  while (1) {
+    editorParseLine(row, at > 0 ? E.row[at - 1].ps_out : 0);
+    editorPanesTouch(at, at);
+    if (++at >= E.numrows) {
+      break;
+    }
+    row = &E.row[at];
+    if (row->hl_done == 0 || row->ps_in == E.row[at - 1].ps_out) {
+      break;
+    }
+  }
+}
+
+unsigned char *editorParseOverlay(erow *row) {
+
+  // rows without structure draw as they are
+  //
+  if (row->nnodes == 0) {
+    return row->hl;
+  }
+
+  // copy the highlighting so the nodes can be drawn over it
+  //
+  static unsigned char *hl = NULL;
+  static int cap = 0;
+  if (cap < row->rsize) {
+    cap = row->rsize;
+    hl = realloc(hl, cap);
+  }
+  memcpy(hl, row->hl, row->rsize);
+
+  // names are looked up now so a definition anywhere
+  // in the buffer shows up straight away
+  //
+  for (int i = 0; i < row->nnodes; i++) {
+    struct editorNode *node = &row->nodes[i];
+    int end = node->start + node->len;
+    if (end > row->rsize) {
+      continue;
+    }
+    int color = (node->kind == NODE_CALL) ? HL_FUNCTION : -1;
+    if (node->kind == NODE_PREPROC) {
+      color = HL_PREPROC;
+    }
+    else {
+      int sym = editorSymbolFind(&row->render[node->start], node->len, 0);
+      if (sym >= 0 && E.symbols.syms[sym].macros > 0) {
+        color = HL_MACRO;
+      }
+      else if (sym >= 0 && E.symbols.syms[sym].types > 0) {
+        color = HL_TYPE;
+      }
+    }
+    if (color < 0) {
+      continue;
+    }
+
+    // leave search matches alone
+    //
+    for (int j = node->start; j < end; j++) {
+      if (hl[j] == HL_NORMAL || (node->kind == NODE_PREPROC && hl[j] == HL_KEYWORD1)) {
+        hl[j] = color;
+      }
+    }
+  }
+  return hl;
+}
+
+/* End Structure Parsing */
+
+/* Bracket Index */
+
+int editorBracketKind(int c, int *open) {
+
+  // which kind of bracket c is and which side
+  //
+  switch (c) {
+    case '(': *open = 1; return BR_PAREN;
+    case ')': *open = 0; return BR_PAREN;
+    case '[': *open = 1; return BR_SQUARE;
+    case ']': *open = 0; return BR_SQUARE;
+    case '{': *open = 1; return BR_BRACE;
+    case '}': *open = 0; return BR_BRACE;
+    default: return -1;
+  }
+}
+
+int editorBracketIsCode(erow *row, int i) {
+
+  // brackets in strings and comments don't count,
+  // a row that was not rendered yet is all plain
+  //
+  if (row->hl == NULL) {
+    return 1;
+  }
+  int hl = row->hl[i];
+  return hl != HL_STRING && hl != HL_COMMENT && hl != HL_MLCOMMENT;
+}
+
+void editorBracketCombine(struct editorBracketSum *out, const struct editorBracketSum *a, const struct editorBracketSum *b) {
+
+  // a run of rows a followed by a run b
+  //
+  for (int k = 0; k < BR_KINDS; k++) {
+    int m = a->d[k] + b->m[k];
+    int rm = -b->d[k] + a->rm[k];
+    out->m[k] = (a->m[k] < m) ? a->m[k] : m;
+    out->rm[k] = (b->rm[k] < rm) ? b->rm[k] : rm;
+    out->d[k] = a->d[k] + b->d[k];
+  }
+}
+
+const struct editorBracketSum *editorBracketSpan(int lo, int len) {
+
+  // the sum of the rows from lo up to lo plus len, a node
+  // without rows on its right side is just its left side
+  //
+  while (len > 1 && lo + len / 2 >= E.numrows) {
+    len /= 2;
+  }
+  if (len == 1) {
+    return &E.row[lo].br;
+  }
+  return &E.brackets.tree[lo + len / 2];
+}
+
+void editorBracketRefresh() {
+  struct editorBrackets *t = &E.brackets;
+
+  // one node for each row
+  //
+  if (t->tree == NULL || t->numrows != E.numrows) {
+    struct editorBracketSum *tree = realloc(t->tree, sizeof(struct editorBracketSum) * (E.numrows > 0 ? E.numrows : 1));
+    if (tree == NULL) {
+      die("realloc");
+    }
+    t->tree = tree;
+    t->numrows = E.numrows;
+  }
+
+  // sum up the nodes that reach past from again, the
+  // lowest ones first so their parents can use them,
+  // rows not rendered yet are summed from their text
+  // as plain rows and the highlighter sums them again
+  // when it colors them
+  //
+  int from = t->from < E.numrows ? t->from : E.numrows;
+  for (int j = from; j < E.numrows; j++) {
+    if (E.row[j].render == NULL) {
+      editorBracketSumRow(&E.row[j]);
+    }
+  }
+  for (int half = 1; half < E.numrows; half *= 2) {
+    for (int g = from / (2 * half) * (2 * half) + half; g < E.numrows; g += 2 * half) {
+      editorBracketCombine(&t->tree[g], editorBracketSpan(g - half, half), editorBracketSpan(g, half));
+    }
+  }
+  t->from = E.numrows;
+}
+
+void editorBracketSumRow(erow *row) {
+
+  // sum up the brackets of the row, from its text
+  // if it was not rendered yet, the brackets come in
+  // the same order either way
+  //
+  const char *text = row->render ? row->render : row->chars;
+  int len = row->render ? row->rsize : row->size;
+  struct editorBracketSum *s = &row->br;
+  memset(s, 0, sizeof(struct editorBracketSum));
+  for (int i = 0; i < len; i++) {
+    int open;
+    int k = editorBracketKind(text[i], &open);
+    if (k < 0 || !editorBracketIsCode(row, i)) {
+      continue;
+    }
+    s->d[k] += open ? 1 : -1;
+    if (s->d[k] < s->m[k]) {
+      s->m[k] = s->d[k];
+    }
+  }
+
+  // reading backwards closing brackets go up
+  //
+  int depth[BR_KINDS] = {0, 0, 0};
+  for (int i = len - 1; i >= 0; i--) {
+    int open;
+    int k = editorBracketKind(text[i], &open);
+    if (k < 0 || !editorBracketIsCode(row, i)) {
+      continue;
+    }
+    depth[k] += open ? -1 : 1;
+    if (depth[k] < s->rm[k]) {
+      s->rm[k] = depth[k];
+    }
+  }
+}
+
+void editorBracketUpdateRow(erow *row) {
+
+  // sum up the brackets of the row
+  //
+  editorBracketSumRow(row);
+
+  // carry the change up the tree if it is there,
+  // otherwise sum it up along with the rest
+  //
+  struct editorBrackets *t = &E.brackets;
+  if (t->tree && t->numrows == E.numrows && row->idx < t->from) {
+    for (int half = 1; half < E.numrows; half *= 2) {
+      int g = row->idx / (2 * half) * (2 * half) + half;
+      if (g < E.numrows) {
+        editorBracketCombine(&t->tree[g], editorBracketSpan(g - half, half), editorBracketSpan(g, half));
+      }
+    }
+  }
+  else {
+    editorBracketInvalidate(row->idx);
+  }
+}
+
+void editorBracketInvalidate(int at) {
+
+  // rows from here on moved, the nodes before
+  // them stay where they are
+  //
+  if (at < E.brackets.from) {
+    E.brackets.from = at > 0 ? at : 0;
+  }
+}
+
+int editorBracketFindForward(int lo, int len, int from, int k, int *depth) {
+
+  // the first row from the given one where the depth drops to zero,
+  // whole runs that stay above it are skipped at once
+  //
+  int hi = (lo + len < E.numrows) ? lo + len : E.numrows;
+  if (lo >= E.numrows || hi <= from) {
+    return -1;
+  }
+  const struct editorBracketSum *s = editorBracketSpan(lo, len);
+  if (lo >= from && *depth + s->m[k] > 0) {
+    *depth += s->d[k];
+    return -1;
+  }
+  if (hi - lo == 1) {
+    return lo;
+  }
+  int r = editorBracketFindForward(lo, len / 2, from, k, depth);
+  if (r >= 0) {
+    return r;
+  }
+  return editorBracketFindForward(lo + len / 2, len / 2, from, k, depth);
+}
+
+int editorBracketFindBackward(int lo, int len, int before, int k, int *depth) {
+
+  // the same going up the file from the row before the given one
+  //
+  int hi = (lo + len < E.numrows) ? lo + len : E.numrows;
+  if (lo >= E.numrows || lo >= before) {
+    return -1;
+  }
+  const struct editorBracketSum *s = editorBracketSpan(lo, len);
+  if (hi <= before && *depth + s->rm[k] > 0) {
+    *depth -= s->d[k];
+    return -1;
+  }
+  if (hi - lo == 1) {
+    return lo;
+  }
+  int r = editorBracketFindBackward(lo + len / 2, len / 2, before, k, depth);
+  if (r >= 0) {
+    return r;
+  }
+  return editorBracketFindBackward(lo, len / 2, before, k, depth);
+}
+
+int editorBracketMatch(int at, int col, int *mrow, int *mcol) {
+
+  // there has to be a bracket in code there
+  //
+  if (at < 0 || at >= E.numrows || col < 0 || col >= E.row[at].rsize) {
+    return 0;
+  }
+  erow *row = &E.row[at];
+  editorRowFill(row);
+  int open;
+  int k = editorBracketKind(row->render[col], &open);
+  if (k < 0 || !editorBracketIsCode(row, col)) {
+    return 0;
+  }
+  if (E.brackets.tree == NULL || E.brackets.numrows != E.numrows || E.brackets.from < E.numrows) {
+    editorBracketRefresh();
+  }
+
+  // look through the rest of the row first
+  //
+  int step = open ? 1 : -1;
+  int depth = 1;
+  for (int i = col + step; i >= 0 && i < row->rsize; i += step) {
+    int o;
+    if (editorBracketKind(row->render[i], &o) != k || !editorBracketIsCode(row, i)) {
+      continue;
+    }
+    depth += (o == open) ? 1 : -1;
+    if (depth == 0) {
+      *mrow = at;
+      *mcol = i;
+      return 1;
+    }
+  }
+
+  // then find the row it closes in
+  //
+  int len = 1;
+  while (len < E.numrows) {
+    len *= 2;
+  }
+  int r;
+  if (open) {
+    r = editorBracketFindForward(0, len, at + 1, k, &depth);
+  }
+  else {
+    r = editorBracketFindBackward(0, len, at, k, &depth);
+  }
+  if (r < 0 || r >= E.numrows) {
+    return 0;
+  }
+
+  // and the bracket within that row, which is
+  // rendered now if it was not yet
+  //
+  row = &E.row[r];
+  editorRowFill(row);
+  int start = open ? 0 : row->rsize - 1;
+  for (int i = start; i >= 0 && i < row->rsize; i += step) {
+    int o;
+    if (editorBracketKind(row->render[i], &o) != k || !editorBracketIsCode(row, i)) {
+      continue;
+    }
+    depth += (o == open) ? 1 : -1;
+    if (depth == 0) {
+      *mrow = r;
+      *mcol = i;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int editorBracketFoldEnd(int at) {
+
+  // find the first brace of the row that is
+  // still open at the end of it
+  //
+  if (at < 0 || at >= E.numrows) {
+    return -1;
+  }
+  erow *row = &E.row[at];
+  editorRowFill(row);
+  if (row->br.d[BR_BRACE] - row->br.m[BR_BRACE] <= 0) {
+    return -1;
+  }
+  int depth = 0;
+  int col = -1;
+  for (int i = 0; i < row->rsize; i++) {
+    int open;
+    if (editorBracketKind(row->render[i], &open) != BR_BRACE || !editorBracketIsCode(row, i)) {
+      continue;
+    }
+    depth += open ? 1 : -1;
+    if (open && depth == row->br.m[BR_BRACE] + 1 && col < 0) {
+      col = i;
+    }
+    if (depth == row->br.m[BR_BRACE]) {
+      col = -1;
+    }
+  }
+
+  // the region runs to the row that closes it
+  //
+  int mrow, mcol;
+  if (col < 0 || !editorBracketMatch(at, col, &mrow, &mcol)) {
+    return -1;
+  }
+  return mrow;
+}
+
+int editorBracketAtCursor(int *col) {
+
+  // the bracket under the cursor or else
+  // the one just before it
+  //
+  if (E.cy >= E.numrows) {
+    return 0;
+  }
+  erow *row = &E.row[E.cy];
+  editorRowFill(row);
+  int open;
+  for (int rx = E.rx; rx >= E.rx - 1 && rx >= 0; rx--) {
+    if (rx < row->rsize && editorBracketKind(row->render[rx], &open) >= 0 && editorBracketIsCode(row, rx)) {
+      *col = rx;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+void editorBracketMark() {
+
+  // find the bracket matching the one at the cursor
+  //
+  int row = -1;
+  int col = -1;
+  int at;
+  if (editorBracketAtCursor(&at) && !editorBracketMatch(E.cy, at, &row, &col)) {
+    row = -1;
+    col = -1;
+  }
+
+  // redraw the rows it moved between
+  //
+  if (row != E.bracket_row || col != E.bracket_col) {
+    if (E.bracket_row >= 0) {
+      editorPanesTouch(E.bracket_row, E.bracket_row);
+    }
+    if (row >= 0) {
+      editorPanesTouch(row, row);
+    }
+    E.bracket_row = row;
+    E.bracket_col = col;
+  }
+}
+
+void editorBracketJump() {
+
+  // move the cursor onto the matching bracket
+  //
+  int at, row, col;
+  if (!editorBracketAtCursor(&at) || !editorBracketMatch(E.cy, at, &row, &col)) {
+    editorSetStatusMessage("No matching bracket");
+    return;
+  }
+  E.cy = row;
+  E.cx = editorRowRxToCx(&E.row[row], col);
+}
+
+/* End Bracket Index */
+
+/* Code Folding */
+
+int editorLayoutActive() {
+
+  // rows and visual lines only differ while
+  // wrapping or when something is folded
+  //
+  return E.wrap || E.folds.n > 0;
+}
+
+int editorFoldFind(int at) {
+
+  // find the last fold starting at or before
+  // the row and check it reaches it
+  //
+  int lo = 0;
+  int hi = E.folds.n;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (E.folds.f[mid].start <= at) {
+      lo = mid + 1;
+    }
+    else {
+      hi = mid;
+    }
+  }
+  if (lo > 0 && E.folds.f[lo - 1].end >= at) {
+    return lo - 1;
+  }
+  return -1;
+}
+
+int editorFoldHidden(int at) {
+
+  // the first row of a fold stays on the screen
+  //
+  int i = editorFoldFind(at);
+  return i >= 0 && E.folds.f[i].start < at;
+}
+
+int editorFoldNext(int at) {
+
+  // skip to the first row after a fold
+  // when the row is hidden in it
+  //
+  int i = editorFoldFind(at);
+  if (i >= 0 && E.folds.f[i].start < at) {
+    return E.folds.f[i].end + 1;
+  }
+  return at;
+}
+
+int editorFoldRegion(int at) {
+
+  // a brace block folds up to its closing brace
+  //
+  int end = editorBracketFoldEnd(at);
+  if (end > at) {
+    return end;
+  }
+
+  // a comment folds up to the row it ends on
+  //
+  erow *row = &E.row[at];
+  int opened = (at > 0 && E.row[at - 1].hl_open_comment);
+  if (!opened && row->hl_open_comment) {
+    for (end = at + 1; end < E.numrows; end++) {
+      if (!E.row[end].hl_open_comment) {
+        return end;
+      }
+    }
+  }
+  return -1;
+}
+
+void editorFoldSet(int start, int end, int on) {
+
+  // remember what is at the top of the screen
+  //
+  int sub;
+  int top = editorLayoutRowOfLine(E.rowoff, &sub);
+  int active = editorLayoutActive();
+
+  // take out the fold at start, or every fold the new
+  // one overlaps so the list stays disjoint, the rows of
+  // all of them have to be laid out again
+  //
+  int first = start;
+  int last = end;
+  int i = 0;
+  int j = 0;
+  for (; i < E.folds.n; i++) {
+    struct editorFold *f = &E.folds.f[i];
+    if (on ? (f->start <= end && f->end >= start) : (f->start == start)) {
+      if (f->start < first) {
+        first = f->start;
+      }
+      if (f->end > last) {
+        last = f->end;
+      }
+      continue;
+    }
+    E.folds.f[j++] = *f;
+  }
+  E.folds.n = j;
+
+  // add the new one in order
+  //
+  if (on) {
+    if (E.folds.n == E.folds.cap) {
+      E.folds.cap = E.folds.cap ? E.folds.cap * 2 : 16;
+      E.folds.f = realloc(E.folds.f, sizeof(struct editorFold) * E.folds.cap);
+    }
+    for (i = E.folds.n; i > 0 && E.folds.f[i - 1].start > start; i--) {
+      E.folds.f[i] = E.folds.f[i - 1];
+    }
+    E.folds.f[i].start = start;
+    E.folds.f[i].end = end;
+    E.folds.n++;
+  }
+
+  // lay the rows out again, from scratch when rows
+  // and visual lines start or stop being the same
+  //
+  if (active != editorLayoutActive()) {
+    editorLayoutFree();
+    editorPanesTouch(0, INT_MAX);
+  }
+  else {
+    for (i = first; i <= last && i < E.numrows; i++) {
+      editorLayoutUpdateRow(i);
+    }
+  }
+
+  // keep the same row at the top of the screen, or the
+  // row of the fold it went into
+  //
+  i = editorFoldFind(top);
+  if (i >= 0) {
+    top = E.folds.f[i].start;
+  }
+  E.rowoff = editorLayoutLineOfRow(top) + (E.wrap ? sub : 0);
+}
+
+void editorFoldToggle() {
+  if (E.cy >= E.numrows) {
+    return;
+  }
+
+  // open the fold the cursor is on
+  //
+  int i = editorFoldFind(E.cy);
+  if (i >= 0) {
+    editorFoldSet(E.folds.f[i].start, E.folds.f[i].end, 0);
+    return;
+  }
+
+  // or fold the region starting on its row
+  //
+  int end = editorFoldRegion(E.cy);
+  if (end <= E.cy) {
+    editorSetStatusMessage("Nothing to fold");
+    return;
+  }
+  editorFoldSet(E.cy, end, 1);
+}
+
+void editorFoldInsertRows(int at, int n) {
+
+  // rows added within a fold open it, folds
+  // below move down
+  //
+  for (int i = 0; i < E.folds.n; i++) {
+    struct editorFold *f = &E.folds.f[i];
+    if (f->start >= at) {
+      f->start += n;
+      f->end += n;
+    }
+    else if (f->end >= at && at > f->start) {
+      f->end = -1;
+    }
+  }
+  editorFoldDrop();
+}
+
+void editorFoldDeleteRows(int at, int n) {
+
+  // rows removed from a fold open it, folds
+  // below move up
+  //
+  for (int i = 0; i < E.folds.n; i++) {
+    struct editorFold *f = &E.folds.f[i];
+    if (f->start >= at + n) {
+      f->start -= n;
+      f->end -= n;
+    }
+    else if (f->end >= at) {
+      f->end = -1;
+    }
+  }
+  editorFoldDrop();
+}
+
+void editorFoldDrop() {
+
+  // take out the folds that were opened, the rows in
+  // them get laid out again when the index is next used
+  //
+  int j = 0;
+  for (int i = 0; i < E.folds.n; i++) {
+    if (E.folds.f[i].end >= 0) {
+      E.folds.f[j++] = E.folds.f[i];
+    }
+  }
+  if (j != E.folds.n) {
+    E.folds.n = j;
+    editorLayoutFree();
+    editorPanesTouch(0, INT_MAX);
+  }
+}
+
+int editorDrawFoldMarker(struct abuf *ab, int at, int room) {
+
+  // show how much a folded row hides
+  //
+  int i = editorFoldFind(at);
+  if (i < 0 || E.folds.f[i].start != at || room <= 0) {
+    return 0;
+  }
+  char buf[48];
+  int len = snprintf(buf, sizeof(buf), " ... %d lines ", E.folds.f[i].end - at);
+  if (len > room) {
+    len = room;
+  }
+  abAppend(ab, "\x1b[7m", 4);
+  abAppend(ab, buf, len);
+  abAppend(ab, "\x1b[m", 3);
+  return len;
+}
+
+/* End Code Folding */
+
+/* Large File Viewer */
+
+void *editorViewScan(void *arg) {
+  struct editorView *v = arg;
+
+  // count the lines a chunk at a time, noting where every
+  // stride-th one starts and giving the pages back once
+  // they were read so the scan never holds on to the file
+  //
+  size_t off = 0;
+  size_t lines = 0;
+  while (off < v->size) {
+    size_t end = off + KILO_VIEW_CHUNK;
+    if (end > v->size) {
+      end = v->size;
+    }
+    const char *p = v->map + off;
+    const char *stop = v->map + end;
+    while ((p = memchr(p, '\n', stop - p)) != NULL) {
+      p++;
+      lines++;
+      if (lines % KILO_VIEW_STRIDE == 0 && (size_t)(p - v->map) < v->size) {
+        pthread_mutex_lock(&v->lock);
+        if (v->nmarks == v->capmarks) {
+          v->capmarks *= 2;
+          v->marks = realloc(v->marks, sizeof(size_t) * v->capmarks);
+        }
+        v->marks[v->nmarks++] = p - v->map;
+        pthread_mutex_unlock(&v->lock);
+      }
+    }
+    madvise(v->map + off, end - off, MADV_DONTNEED);
+    pthread_mutex_lock(&v->lock);
+    v->lines = lines;
+    v->scanned = end;
+    pthread_mutex_unlock(&v->lock);
+    off = end;
+  }
+
+  // a last line without a newline still counts
+  //
+  pthread_mutex_lock(&v->lock);
+  if (v->size > 0 && v->map[v->size - 1] != '\n') {
+    lines++;
+  }
+  v->lines = lines;
+  v->done = 1;
+  pthread_mutex_unlock(&v->lock);
+  return NULL;
+}
+
+void editorViewOpen(char *filename) {
+  struct editorView *v = &E.view;
+
+  // map the file instead of reading it, only the
+  // pages that are looked at get read in
+  //
+  int fd = open(filename, O_RDONLY);
+  if (fd == -1) {
+    die("open");
+  }
+  struct stat st;
+  if (fstat(fd, &st) == -1) {
+    die("fstat");
+  }
+  v->size = st.st_size;
+  if (v->size > 0) {
+    v->map = mmap(NULL, v->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (v->map == MAP_FAILED) {
+      die("mmap");
+    }
+  }
+  close(fd);
+
+  free(E.filename);
+  E.filename = strdup(filename);
+  editorSelectSyntaxHighlight();
+
+  // the first line starts the index, the rest of it
+  // is filled in by the scan
+  //
+  v->capmarks = 64;
+  v->marks = malloc(sizeof(size_t) * v->capmarks);
+  v->marks[0] = 0;
+  v->nmarks = 1;
+  pthread_mutex_init(&v->lock, NULL);
+  v->active = 1;
+
+  // without a thread the scan runs before
+  // anything is shown
+  //
+  if (pthread_create(&v->thread, NULL, editorViewScan, v) != 0) {
+    editorViewScan(v);
+  }
+
+  editorViewLoad(0, 0);
+}
+
+size_t editorViewLineStart(size_t off) {
+
+  // the line holding off starts after the
+  // newline before it
+  //
+  char *p = memrchr(E.view.map, '\n', off);
+  return p ? (size_t)(p - E.view.map) + 1 : 0;
+}
+
+size_t editorViewNextLine(size_t off) {
+
+  // the line after the one starting at off
+  //
+  struct editorView *v = &E.view;
+  char *p = memchr(v->map + off, '\n', v->size - off);
+  return p ? (size_t)(p - v->map) + 1 : v->size;
+}
+
+int editorViewOffsetOfLine(size_t *line, size_t *start) {
+  struct editorView *v = &E.view;
+
+  // start from the closest line the index knows of, a
+  // line the scan did not get near yet is left to it
+  // instead of walking there from the last one
+  //
+  pthread_mutex_lock(&v->lock);
+  size_t k = *line / KILO_VIEW_STRIDE;
+  if (k >= v->nmarks) {
+    if (!v->done) {
+      pthread_mutex_unlock(&v->lock);
+      return 0;
+    }
+    k = v->nmarks - 1;
+  }
+  size_t off = v->marks[k];
+  pthread_mutex_unlock(&v->lock);
+
+  // and walk the rest, a line past the end of
+  // the file is the last line
+  //
+  size_t n = k * KILO_VIEW_STRIDE;
+  while (n < *line && off < v->size) {
+    off = editorViewNextLine(off);
+    n++;
+  }
+  if (off >= v->size && n > 0) {
+    off = editorViewLineStart(v->size - 1);
+    n--;
+  }
+  *line = n;
+  *start = off;
+  return 1;
+}
+
+size_t editorViewLineOfOffset(size_t off) {
+  struct editorView *v = &E.view;
+
+  // find the last indexed line starting at or
+  // before off by bisection
+  //
+  pthread_mutex_lock(&v->lock);
+  size_t lo = 0;
+  size_t hi = v->nmarks;
+  while (hi - lo > 1) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (v->marks[mid] <= off) {
+      lo = mid;
+    }
+    else {
+      hi = mid;
+    }
+  }
+  size_t from = v->marks[lo];
+  pthread_mutex_unlock(&v->lock);
+
+  // and count the newlines between them
+  //
+  size_t line = lo * KILO_VIEW_STRIDE;
+  const char *p = v->map + from;
+  const char *stop = v->map + off;
+  while (p < stop && (p = memchr(p, '\n', stop - p)) != NULL) {
+    p++;
+    line++;
+  }
+  return line;
+}
+
+void editorViewInsertRow(int at, size_t off) {
+
+  // load the line starting at off as a row, leaving out
+  // the line ending and anything past the longest
+  // part of a line that is shown
+  //
+  struct editorView *v = &E.view;
+  size_t len = editorViewNextLine(off) - off;
+  while (len > 0 && (v->map[off + len - 1] == '\n' || v->map[off + len - 1] == '\r')) {
+    len--;
+  }
+  if (len > KILO_VIEW_LINE_MAX) {
+    len = KILO_VIEW_LINE_MAX;
+  }
+  editorInsertRow(at, v->map + off, len);
+}
+
+void editorViewLoad(size_t off, size_t line) {
+  struct editorView *v = &E.view;
+
+  // drop the rows that are loaded
+  //
+  E.hl_defer = 1;
+  editorDelRows(0, E.numrows);
+
+  // start half a window above the line at off
+  // and load a window from there
+  //
+  int above = 0;
+  v->start = off;
+  v->base = line;
+  while (above < KILO_VIEW_WINDOW / 2 && v->start > 0) {
+    v->start = editorViewLineStart(v->start - 1);
+    v->base--;
+    above++;
+  }
+  v->end = v->start;
+  while (E.numrows < KILO_VIEW_WINDOW && v->end < v->size) {
+    editorViewInsertRow(E.numrows, v->end);
+    v->end = editorViewNextLine(v->end);
+  }
+  E.hl_defer = 0;
+  E.dirty = 0;
+
+  // put the cursor on the line and center
+  // the window on it
+  //
+  E.cy = above;
+  E.cx = 0;
+  E.rowoff = editorLayoutLineOfRow(E.cy) - E.screenrows / 2;
+  if (E.rowoff < 0) {
+    E.rowoff = 0;
+  }
+}
+
+void editorViewShift() {
+  struct editorView *v = &E.view;
+
+  // row at the top of the screen, kept there
+  // while the window moves under it
+  //
+  int sub = 0;
+  int top = editorLayoutRowOfLine(E.rowoff, &sub);
+  int moved = 0;
+
+  // near the top load half a window of the lines above
+  // and drop as many from the bottom
+  //
+  if (E.cy < KILO_VIEW_MARGIN && v->start > 0) {
+    E.hl_defer = 1;
+    while (moved < KILO_VIEW_WINDOW / 2 && v->start > 0) {
+      v->start = editorViewLineStart(v->start - 1);
+      editorViewInsertRow(0, v->start);
+      moved++;
+    }
+    v->base -= moved;
+    for (int j = KILO_VIEW_WINDOW; j < E.numrows; j++) {
+      v->end = editorViewLineStart(v->end - 1);
+    }
+    editorDelRows(KILO_VIEW_WINDOW, E.numrows);
+  }
+
+  // near the bottom the other way around
+  //
+  else if (E.cy >= E.numrows - KILO_VIEW_MARGIN && v->end < v->size) {
+    E.hl_defer = 1;
+    while (moved < KILO_VIEW_WINDOW / 2 && v->end < v->size) {
+      editorViewInsertRow(E.numrows, v->end);
+      v->end = editorViewNextLine(v->end);
+      moved++;
+    }
+    moved = 0;
+    while (E.numrows + moved > KILO_VIEW_WINDOW) {
+      v->start = editorViewNextLine(v->start);
+      moved--;
+    }
+    editorDelRows(0, -moved);
+    v->base -= moved;
+  }
+  else {
+    return;
+  }
+  E.hl_defer = 0;
+  E.dirty = 0;
+
+  // rows moved by as many as were added or
+  // dropped at the top
+  //
+  E.cy += moved;
+  top += moved;
+  if (top < 0) {
+    top = 0;
+    sub = 0;
+  }
+  E.rowoff = editorLayoutLineOfRow(top) + sub;
+}
+
+void editorViewGoto(char *query) {
+  struct editorView *v = &E.view;
+  if (v->size == 0) {
+    return;
+  }
+
+  // a percentage is a position in the bytes of the file so
+  // it works before the scan got there, like the end
+  //
+  size_t off;
+  size_t line;
+  if (!strcmp(query, "$")) {
+    off = editorViewLineStart(v->size - 1);
+    line = editorViewLineOfOffset(off);
+  }
+  else {
+    long long value;
+    int percent;
+    if (!editorGotoParse(query, &value, &percent)) {
+      return;
+    }
+    if (percent) {
+      off = editorViewLineStart((size_t)((v->size - 1) * (double)value / 100));
+      line = editorViewLineOfOffset(off);
+    }
+    else {
+      line = value - 1;
+      if (!editorViewOffsetOfLine(&line, &off)) {
+        pthread_mutex_lock(&v->lock);
+        size_t lines = v->lines;
+        pthread_mutex_unlock(&v->lock);
+        editorSetStatusMessage("Still scanning, %zu lines so far", lines);
+        return;
+      }
+    }
+  }
+  editorViewLoad(off, line);
+}
+
+int editorViewFind(char *query, int dir) {
+  struct editorView *v = &E.view;
+  size_t qlen = strlen(query);
+  if (qlen == 0) {
+    return 0;
+  }
+
+  // search the file past the end of the window, or before
+  // its start a chunk at a time keeping the last hit, a
+  // chunk reaches into the next so no hit is split
+  //
+  const char *hit = NULL;
+  if (dir > 0) {
+    hit = memmem(v->map + v->end, v->size - v->end, query, qlen);
+  }
+  else {
+    size_t to = v->start;
+    while (to > 0 && hit == NULL) {
+      size_t from = to > KILO_VIEW_CHUNK ? to - KILO_VIEW_CHUNK : 0;
+      size_t stop = to + qlen - 1;
+      if (stop > v->start) {
+        stop = v->start;
+      }
+      const char *p = v->map + from;
+      while ((p = memmem(p, v->map + stop - p, query, qlen)) != NULL) {
+        hit = p++;
+      }
+      to = from;
+    }
+  }
+  if (hit == NULL) {
+    return 0;
+  }
+
+  // load the window around it with the
+  // cursor on the hit
+  //
+  size_t off = hit - v->map;
+  size_t start = editorViewLineStart(off);
+  editorViewLoad(start, editorViewLineOfOffset(start));
+  if (E.cy < E.numrows) {
+    E.cx = off - start;
+    if (E.cx > E.row[E.cy].size) {
+      E.cx = E.row[E.cy].size;
+    }
+  }
+  return 1;
+}
+
+int editorViewAllows(int c) {
+
+  // everything that changes the rows or
+  // the buffers is left out, c has had its
+  // modifiers normalised already
+  //
+  switch (c) {
+    case '\r':
+    case CTRL_KEY('k'):
+    case BACKSPACE:
+    case DEL_KEY:
+    case CTRL_KEY('s'):
+    case CTRL_KEY('o'):
+    case CTRL_KEY('n'):
+    case CTRL_KEY('t'):
+    case ARROW_DOWN | KEY_CTRL:
+      return 0;
+    case ARROW_LEFT:
+    case ARROW_RIGHT:
+    case ARROW_UP:
+    case ARROW_DOWN:
+    case HOME_KEY:
+    case END_KEY:
+    case PAGE_UP:
+    case PAGE_DOWN:
+    case ARROW_LEFT | KEY_CTRL:
+    case ARROW_RIGHT | KEY_CTRL:
+    case CTRL_KEY('q'):
+    case CTRL_KEY('a'):
+    case CTRL_KEY('e'):
+    case CTRL_KEY('l'):
+    case CTRL_KEY('f'):
+    case CTRL_KEY('w'):
+    case CTRL_KEY('g'):
+    case CTRL_KEY('u'):
+    case CTRL_KEY('b'):
+    case CTRL_KEY('y'):
+    case CTRL_KEY('d'):
+    case '\x1b':
+      return 1;
+  }
+  return 0;
+}
+
+/* End Large File Viewer */
+
+/* Following Files */
+
+void editorFollowStart(char *filename, int maxrows) {
+  struct editorFollow *f = &E.follow;
+
+  // keep the file open and watch it for writes, a file
+  // that gets truncated is read again from the start
+  //
+  f->fd = open(filename, O_RDONLY);
+  if (f->fd == -1) {
+    die("open");
+  }
+  f->watch = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (f->watch == -1 || inotify_add_watch(f->watch, filename, IN_MODIFY) == -1) {
+    die("inotify");
+  }
+  f->offset = 0;
+  f->open = 0;
+  f->buf = E.curbuf;
+  f->maxrows = maxrows;
+  f->active = 1;
+
+  free(E.filename);
+  E.filename = strdup(filename);
+  editorSelectSyntaxHighlight();
+
+  // the file so far comes in the same way as
+  // everything written to it later
+  //
+  E.hl_defer = 1;
+  editorFollowRead();
+  E.hl_defer = 0;
+  if (E.syntax == NULL) {
+    editorSelectSyntaxHighlight();
+  }
+}
+
+void editorFollowStop() {
+  struct editorFollow *f = &E.follow;
+  if (!f->active) {
+    return;
+  }
+  close(f->watch);
+  close(f->fd);
+  f->active = 0;
+}
+
+int editorFollowRead() {
+  struct editorFollow *f = &E.follow;
+
+  // take the events, what they were does not matter
+  // since the size of the file says what changed
+  //
+  char events[4096];
+  while (read(f->watch, events, sizeof(events)) > 0) {
+  }
+
+  // rows only go into the buffer showing the file, it
+  // catches up when it is switched to
+  //
+  if (E.curbuf != f->buf) {
+    return 0;
+  }
+  struct stat st;
+  if (fstat(f->fd, &st) == -1 || st.st_size == f->offset) {
+    return 0;
+  }
+
+  // the cursor on the last row follows the end of the
+  // file, the rows that come in are not modifications
+  //
+  int tail = (E.cy >= E.numrows - 1);
+  int clean = !editorIsDirty();
+
+  // rows above the last one stay as they are, so only
+  // the rows from there on are saved again
+  //
+  int from = (f->open && E.numrows > 0) ? E.numrows - 1 : E.numrows;
+  int drop = 0;
+
+  // a truncated file starts over
+  //
+  if (st.st_size < f->offset) {
+    editorFollowTrim(E.numrows);
+    f->offset = 0;
+    f->open = 0;
+    from = 0;
+  }
+
+  // read what was added a chunk at a time, the first line
+  // finishes the last row if that was left open
+  //
+  char *chunk = malloc(KILO_FOLLOW_CHUNK);
+  ssize_t nread;
+  while ((nread = pread(f->fd, chunk, KILO_FOLLOW_CHUNK, f->offset)) > 0) {
+    f->offset += nread;
+    char *p = chunk;
+    size_t len = nread;
+    if (f->open && E.numrows > 0) {
+      char *nl = memchr(p, '\n', len);
+      size_t head = (nl ? nl : p + len) - p;
+      size_t keep = head;
+      if (nl && keep > 0 && p[keep - 1] == '\r') {
+        keep--;
+      }
+      editorRowAppendString(&E.row[E.numrows - 1], p, keep);
+      f->open = (nl == NULL);
+      if (nl) {
+        head++;
+      }
+      p += head;
+      len -= head;
+    }
+    if (len > 0) {
+      editorAppendRows(p, len);
+      f->open = (p[len - 1] != '\n');
+    }
+  }
+  free(chunk);
+
+  // drop the oldest rows past the limit, a batch at a
+  // time so it is not done on every write
+  //
+  if (f->maxrows > 0 && E.numrows > f->maxrows + f->maxrows / 8) {
+    drop = E.numrows - f->maxrows;
+    editorFollowTrim(drop);
+  }
+  if (clean) {
+    editorHashSaveFrom(drop, from - drop);
+  }
+
+  if (tail) {
+    E.cy = E.numrows > 0 ? E.numrows - 1 : 0;
+    E.cx = 0;
+  }
+  return 1;
+}
+
+void editorFollowTrim(int n) {
+
+  // drop the first n rows in one go
+  //
+  if (n <= 0 || n > E.numrows) {
+    return;
+  }
+  editorCursorsClear();
+  editorSelectionClear();
+  int sub;
+  int top = editorLayoutRowOfLine(E.rowoff, &sub);
+  editorDelRows(0, n);
+
+  // keep the cursor and the window on the same rows
+  // while they are still there
+  //
+  E.cy = E.cy > n ? E.cy - n : 0;
+  top = top > n ? top - n : 0;
+  E.rowoff = editorLayoutLineOfRow(top) + sub;
+}
+
+/* End Following Files */
+
+/* Reloading Files */
+
+void editorDiskStart() {
+
+  // one instance watches every open file, without
+  // it changes simply go unnoticed
+  //
+  E.watch = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+}
+
+void editorDiskWatch() {
+
+  // watch the file and remember what it looks like, a
+  // file replaced by a rename is watched again when the
+  // old one goes away
+  //
+  struct stat st;
+  E.disk.changed = 0;
+  if (E.filename == NULL || stat(E.filename, &st) == -1) {
+    return;
+  }
+  E.disk.mtime = st.st_mtim;
+  E.disk.size = st.st_size;
+  if (E.watch >= 0 && E.disk.wd < 0) {
+    E.disk.wd = inotify_add_watch(E.watch, E.filename, IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF);
+  }
+}
+
+void editorDiskUnwatch() {
+
+  // stop watching the file unless another
+  // buffer has it open too
+  //
+  if (E.disk.wd < 0) {
+    return;
+  }
+  for (int i = 0; i < E.numbuffers; i++) {
+    if (i != E.curbuf && E.buffers[i].disk.wd == E.disk.wd) {
+      E.disk.wd = -1;
+      return;
+    }
+  }
+  inotify_rm_watch(E.watch, E.disk.wd);
+  E.disk.wd = -1;
+}
+
+void editorDiskPoll() {
+
+  // mark every buffer the events are about, a watch that
+  // was dropped because the file went away is gone for good
+  //
+  char buf[4096];
+  ssize_t len;
+  while ((len = read(E.watch, buf, sizeof(buf))) > 0) {
+    for (char *p = buf; p < buf + len; ) {
+      struct inotify_event ev;
+      memcpy(&ev, p, sizeof(ev));
+      p += sizeof(ev) + ev.len;
+      if (ev.wd == E.disk.wd) {
+        E.disk.changed = 1;
+        if (ev.mask & IN_IGNORED) {
+          E.disk.wd = -1;
+        }
+      }
+      for (int i = 0; i < E.numbuffers; i++) {
+        if (i != E.curbuf && E.buffers[i].disk.wd == ev.wd) {
+          E.buffers[i].disk.changed = 1;
+          if (ev.mask & IN_IGNORED) {
+            E.buffers[i].disk.wd = -1;
+          }
+        }
+      }
+    }
+  }
+  editorDiskCheck();
+}
+
+void editorDiskCheck() {
+
+  // only the current buffer is looked at, the others
+  // are when they are switched to
+  //
+  if (!E.disk.changed) {
+    return;
+  }
+  E.disk.changed = 0;
+  struct stat st;
+  if (E.filename == NULL || stat(E.filename, &st) == -1) {
+    editorSetStatusMessage("%.20s was removed from disk", E.filename ? E.filename : "[No Name]");
+    return;
+  }
+
+  // writes of its own come back as events too
+  //
+  if (st.st_mtim.tv_sec == E.disk.mtime.tv_sec && st.st_mtim.tv_nsec == E.disk.mtime.tv_nsec && st.st_size == E.disk.size) {
+    editorDiskWatch();
+    return;
+  }
+
+  // pick the changes up right away unless that
+  // would throw modifications away
+  //
+  if (editorIsDirty()) {
+    editorSetStatusMessage("%.20s changed on disk, Ctrl-R reloads and drops your changes", E.filename);
+    return;
+  }
+  editorReload();
+}
+
+int editorReloadDiff(erow *rows, uint64_t *oh, uint64_t *nh, char **nl, int *nlen, int n, int m, struct editorHunk **hunks) {
+
+  // shortest edit script between the rows and the lines
+  // by following the furthest reaching path for every number
+  // of edits, v holds where each diagonal got to and trace
+  // keeps the diagonals every step reached to walk back along
+  //
+  int max = n + m;
+  if (max > KILO_RELOAD_MAX_EDITS) {
+    max = KILO_RELOAD_MAX_EDITS;
+  }
+  int *v = calloc(2 * max + 3, sizeof(int));
+  int **trace = malloc(sizeof(int *) * (max + 1));
+  int off = max + 1;
+  int d;
+  int found = 0;
+  for (d = 0; d <= max && !found; d++) {
+    for (int k = -d; k <= d; k += 2) {
+      int x;
+      if (k == -d || (k != d && v[off + k - 1] < v[off + k + 1])) {
+        x = v[off + k + 1];
+      }
+      else {
+        x = v[off + k - 1] + 1;
+      }
+      int y = x - k;
+      while (x < n && y < m && oh[x] == nh[y] && rows[x].size == nlen[y] && !memcmp(rows[x].chars, nl[y], nlen[y])) {
+        x++;
+        y++;
+      }
+      v[off + k] = x;
+      if (x >= n && y >= m) {
+        found = 1;
+      }
+    }
+    trace[d] = malloc(sizeof(int) * (2 * d + 1));
+    memcpy(trace[d], &v[off - d], sizeof(int) * (2 * d + 1));
+  }
+
+  // too far apart to be worth it, everything
+  // is one change
+  //
+  int nhunks = 0;
+  if (!found) {
+    *hunks = malloc(sizeof(struct editorHunk));
+    (*hunks)[0].a = 0;
+    (*hunks)[0].da = n;
+    (*hunks)[0].b = 0;
+    (*hunks)[0].db = m;
+    nhunks = 1;
+  }
+
+  // walk back from the end collecting the rows that stay,
+  // the runs between them are what changed
+  //
+  else {
+    int *keepx = malloc(sizeof(int) * ((n < m ? n : m) + 1));
+    int *keepy = malloc(sizeof(int) * ((n < m ? n : m) + 1));
+    int nkeep = 0;
+    int x = n;
+    int y = m;
+    for (int step = d - 1; step >= 0; step--) {
+      int k = x - y;
+      int px;
+      int py;
+      int mx;
+      if (step == 0) {
+        px = 0;
+        py = 0;
+        mx = 0;
+      }
+      else {
+        int *pv = trace[step - 1] + step - 1;
+        int pk;
+        if (k == -step || (k != step && pv[k - 1] < pv[k + 1])) {
+          pk = k + 1;
+          px = pv[pk];
+          mx = px;
+        }
+        else {
+          pk = k - 1;
+          px = pv[pk];
+          mx = px + 1;
+        }
+        py = px - pk;
+      }
+      while (x > mx) {
+        x--;
+        y--;
+        keepx[nkeep] = x;
+        keepy[nkeep] = y;
+        nkeep++;
+      }
+      x = px;
+      y = py;
+    }
+
+    // the kept rows came out last first
+    //
+    *hunks = malloc(sizeof(struct editorHunk) * (nkeep + 1));
+    int ox = 0;
+    int oy = 0;
+    for (int i = nkeep - 1; i >= -1; i--) {
+      int kx = i >= 0 ? keepx[i] : n;
+      int ky = i >= 0 ? keepy[i] : m;
+      if (kx > ox || ky > oy) {
+        (*hunks)[nhunks].a = ox;
+        (*hunks)[nhunks].da = kx - ox;
+        (*hunks)[nhunks].b = oy;
+        (*hunks)[nhunks].db = ky - oy;
+        nhunks++;
+      }
+      ox = kx + 1;
+      oy = ky + 1;
+    }
+    free(keepx);
+    free(keepy);
+  }
+
+  for (int i = 0; i < d; i++) {
+    free(trace[i]);
+  }
+  free(trace);
+  free(v);
+  return nhunks;
+}
+
+int editorReloadMap(struct editorHunk *h, int nh, int row) {
+
+  // where a row ends up once the hunks are applied,
+  // a row that is replaced goes to the start of
+  // what replaced it
+  //
+  int shift = 0;
+  for (int i = 0; i < nh; i++) {
+    if (row < h[i].a) {
+      break;
+    }
+    if (row < h[i].a + h[i].da) {
+      int at = h[i].a + shift;
+      return row - h[i].a < h[i].db ? at + row - h[i].a : at + (h[i].db > 0 ? h[i].db - 1 : 0);
+    }
+    shift += h[i].db - h[i].da;
+  }
+  return row + shift;
+}
+
+void editorReload() {
+  if (E.filename == NULL) {
+    return;
+  }
+  editorCursorsClear();
+  editorSelectionClear();
+
+  // read the whole file and split it into lines
+  //
+  int fd = open(E.filename, O_RDONLY);
+  if (fd == -1) {
+    editorSetStatusMessage("Can't reload! I/O error: %s", strerror(errno));
+    return;
+  }
+  struct stat st;
+  if (fstat(fd, &st) == -1) {
+    editorSetStatusMessage("Can't reload! I/O error: %s", strerror(errno));
+    close(fd);
+    return;
+  }
+  char *buf = malloc(st.st_size + 1);
+  ssize_t size = 0;
+  ssize_t nread;
+  while (size < st.st_size && (nread = read(fd, buf + size, st.st_size - size)) > 0) {
+    size += nread;
+  }
+  close(fd);
+  int m = 0;
+  int cap = 64;
+  char **nl = malloc(sizeof(char *) * cap);
+  int *nlen = malloc(sizeof(int) * cap);
+  for (char *p = buf; p < buf + size; ) {
+    char *end = memchr(p, '\n', buf + size - p);
+    int len = (end ? end : buf + size) - p;
+    if (m == cap) {
+      cap *= 2;
+      nl = realloc(nl, sizeof(char *) * cap);
+      nlen = realloc(nlen, sizeof(int) * cap);
+    }
+    nl[m] = p;
+    nlen[m] = (len > 0 && p[len - 1] == '\r') ? len - 1 : len;
+    m++;
+    p = end ? end + 1 : buf + size;
+  }
+
+  // the rows and lines the two ends have in common
+  // are left alone without hashing them
+  //
+  int pre = 0;
+  while (pre < E.numrows && pre < m && E.row[pre].size == nlen[pre] && !memcmp(E.row[pre].chars, nl[pre], nlen[pre])) {
+    pre++;
+  }
+  int suf = 0;
+  while (suf < E.numrows - pre && suf < m - pre) {
+    erow *row = &E.row[E.numrows - 1 - suf];
+    int j = m - 1 - suf;
+    if (row->size != nlen[j] || memcmp(row->chars, nl[j], nlen[j])) {
+      break;
+    }
+    suf++;
+  }
+
+  // match up the rest by the hashes the rows keep
+  //
+  int n = E.numrows - pre - suf;
+  int mid = m - pre - suf;
+  uint64_t *oh = malloc(sizeof(uint64_t) * (n + 1));
+  uint64_t *nh = malloc(sizeof(uint64_t) * (mid + 1));
+  for (int i = 0; i < n; i++) {
+    oh[i] = E.row[pre + i].hash;
+  }
+  for (int i = 0; i < mid; i++) {
+    nh[i] = editorHash64(nl[pre + i], nlen[pre + i]);
+  }
+  struct editorHunk *h = NULL;
+  int count = 0;
+  if (n > 0 || mid > 0) {
+    count = editorReloadDiff(&E.row[pre], oh, nh, nl + pre, nlen + pre, n, mid, &h);
+  }
+  for (int i = 0; i < count; i++) {
+    h[i].a += pre;
+    h[i].b += pre;
+  }
+
+  // work out where the cursor and the top of every
+  // pane end up before any row moves
+  //
+  editorPaneStash(&E.panes[E.curpane]);
+  int tops[2];
+  int subs[2];
+  for (int i = 0; i < E.numpanes; i++) {
+    tops[i] = editorLayoutRowOfLine(E.panes[i].rowoff, &subs[i]);
+  }
+
+  // replace the runs that changed from the bottom up so
+  // the rows above each one stay where they are, rows
+  // that did not change keep their highlighting
+  //
+  struct editorSlice *lines = malloc(sizeof(struct editorSlice) * (m > 0 ? m : 1));
+  for (int j = 0; j < m; j++) {
+    lines[j].text = buf;
+    lines[j].off = nl[j] - buf;
+    lines[j].len = nlen[j];
+    lines[j].shared = 0;
+  }
+  E.hl_defer = 1;
+  for (int i = count - 1; i >= 0; i--) {
+    editorDelRows(h[i].a, h[i].a + h[i].da);
+    editorInsertRows(h[i].a, lines + h[i].b, h[i].db);
+  }
+  E.hl_defer = 0;
+  free(lines);
+
+  for (int i = 0; i < E.numpanes; i++) {
+    struct editorPane *p = &E.panes[i];
+    p->cy = editorReloadMap(h, count, p->cy);
+    if (p->cy > E.numrows) {
+      p->cy = E.numrows;
+    }
+    if (p->cy < E.numrows && p->cx > E.row[p->cy].size) {
+      p->cx = E.row[p->cy].size;
+    }
+    p->rowoff = editorLayoutLineOfRow(editorReloadMap(h, count, tops[i])) + subs[i];
+  }
+  editorPaneLoad(&E.panes[E.curpane]);
+
+  int changed = 0;
+  for (int i = 0; i < count; i++) {
+    changed += h[i].db > h[i].da ? h[i].db : h[i].da;
+  }
+  free(h);
+  free(oh);
+  free(nh);
+  free(nl);
+  free(nlen);
+  free(buf);
+
+  editorHashSave();
+  editorDiskWatch();
+  editorSetStatusMessage("Reloaded %.20s, %d lines changed", E.filename, changed);
+}
+
+/* End Reloading Files */
+
+/* Cursor Actions */
+
+int getCursorPosition(int *rows, int *cols) {
+
+  // variables to iterate through and read
+  // the response to the cursor position
+  //
+  char buf[32];
+
+  // subtract the row offset from the screen
+  //
+  snprintf(buf, sizeof(buf), "\x1b[%d;%dH", (E.cy - E.rowoff) + 1, E.cx + 1);
+
+  unsigned int i = 0;
+
+  // request cursor position
+  //
+  if (write(STDOUT_FILENO, "\x1b[6n", 4) != 4){
+    return -1;
+  }
+
+  // move crusor to beginning of line and print new line
+  //
+  printf("\r\n");
+  
+  // read the cursor position byte by byte
+  //
+  while (i < sizeof(buf) - 1) {
+
+    // if it fails to read break
+    // if it finds 'R' break
+    //
+    // reads do not wait so give the answer a tenth
+    // of a second to arrive
+    //
+    struct pollfd pfd = {STDIN_FILENO, POLLIN, 0};
+    if (poll(&pfd, 1, 100) != 1) break;
+    if (read(STDIN_FILENO, &buf[i], 1) != 1) break;
+    if (buf[i] == 'R') break;
+    i++;
+  }
+
+  // set the last character to a null terminating character
+  //
+  buf[i] = '\0';
+
+  // checks to see if it's an escape sequence
+  //
+  if (buf[0] != '\x1b' || buf[1] != '['){
+
+    // return fail
+    //
+    return -1;
+  }
+
+  // read the two numbers that indicate cursor position
+  //
+  if (sscanf(&buf[2], "%d;%d", rows, cols) != 2){
+
+    // return fail
+    //
+    return -1;
+  }
+
+  // return success
+  //
+  return 0;
+}
+
+void editorMoveCursor(int key) {
+  
+  // set the current row that we are on
+  //
+  erow *row = (E.cy >= E.numrows) ? NULL : &E.row[E.cy];
+
+  // depending on the case move the cursor aroudn
+  // the if statements prevent the cursor from going
+  // off screen
+  //
+  switch (key) {
+    case ARROW_LEFT:
+      if (E.cx != 0) {
+        E.cx--;
+      }
+      else if (E.cy > 0) {
+        E.cy--;
+
+        // land on the row a fold hides its rows under
+        //
+        int fold = editorFoldFind(E.cy);
+        if (fold >= 0) {
+          E.cy = E.folds.f[fold].start;
+        }
+        E.cx = E.row[E.cy].size;
+      }
+      break;
+    case ARROW_RIGHT:
+      if (row && E.cx < row->size) {
+        E.cx++;
+      }
+      else if (row && E.cx == row->size) {
+        E.cy = editorFoldNext(E.cy + 1);
+        E.cx = 0;
+      }
+      break;
+    case ARROW_UP:
+      if (editorLayoutActive()) {
+        editorMoveCursorVisual(-1);
+      }
+      else if (E.cy != 0) {
+        E.cy--;
+      }
+      break;
+    case ARROW_DOWN:
+      if (editorLayoutActive()) {
+        editorMoveCursorVisual(1);
+      }
+      else if (E.cy < E.numrows-1) {
+        E.cy++;
+      }
+      break;
+  }
+  
+  // set the row again since we could be on a different 
+  // line
+  //
+  row = (E.cy >= E.numrows) ? NULL : &E.row[E.cy];
+
+  // set the length of the row
+  //
+  int rowlen = row ? row->size : 0;
+
+  // if it's longer than the row
+  // reset to the end of the row
+  //
+  if (E.cx > rowlen) {
+    E.cx = rowlen;
+  }
+}
+
+void editorMoveCursorVisual(int delta) {
+
+  // nothing to move through in an empty file
+  //
+  int total = editorLayoutTotal();
+  if (total == 0) {
+    return;
+  }
+
+  // find the visual line and column the cursor is on,
+  // past the end of the file counts as one line further
+  //
+  int width = E.wrap ? editorWrapWidth() : INT_MAX;
+  int line = total;
+  int col = 0;
+  if (E.cy < E.numrows) {
+    int rx = editorRowCxToRx(&E.row[E.cy], E.cx);
+    line = editorLayoutLineOfRow(E.cy) + rx / width;
+    col = rx % width;
+  }
+
+  // move and keep the column
+  //
+  editorSetCursorLine(line + delta, col);
+}
+
+void editorSetCursorLine(int line, int col) {
+
+  // nothing to land on in an empty file
+  //
+  int total = editorLayoutTotal();
+  if (total == 0) {
+    return;
+  }
+
+  // keep the cursor on the last line
+  // like the arrow keys do
+  //
+  if (line < 0) {
+    line = 0;
+  }
+  if (line > total - 1) {
+    line = total - 1;
+  }
+
+  // map the line back to a row and keep the column
+  // within the wrapped segment
+  //
+  int sub;
+  E.cy = editorLayoutRowOfLine(line, &sub);
+  E.cx = editorRowRxToCx(&E.row[E.cy], E.wrap ? sub * editorWrapWidth() + col : col);
+}
+
+void editorPageMove(int dir) {
+
+  // column to keep while paging, relative to the
+  // wrapped segment when wrapping
+  //
+  int col = 0;
+  if (E.cy < E.numrows) {
+    col = editorRowCxToRx(&E.row[E.cy], E.cx);
+    if (E.wrap) {
+      col %= editorWrapWidth();
+    }
+  }
+
+  // move the window by a page in one step
+  //
+  int total = editorLayoutTotal();
+  E.rowoff += dir * E.screenrows;
+  if (E.rowoff > total - 1) {
+    E.rowoff = total - 1;
+  }
+  if (E.rowoff < 0) {
+    E.rowoff = 0;
+  }
+
+  // paging up leaves the cursor at the top of the window
+  // and paging down leaves it at the bottom
+  //
+  editorSetCursorLine(dir < 0 ? E.rowoff : E.rowoff + E.screenrows - 1, col);
+}
+
+void editorGotoLine() {
+
+  // ask for the target
+  //
+  char *query = editorPrompt("Go to line: %s (N, N%%, $ for end) (ESC to cancel)", NULL);
+  if (query == NULL) {
+    return;
+  }
+
+  // the viewer finds the line in the file
+  // instead of the loaded rows
+  //
+  if (E.view.active) {
+    editorViewGoto(query);
+    free(query);
+    return;
+  }
+
+  // nothing to jump to
+  //
+  if (E.numrows == 0) {
+    free(query);
+    return;
+  }
+
+  // work out the target row from the query, a trailing
+  // percent sign is a position within the file and a
+  // dollar sign is the end of the file
+  //
+  int target;
+  long long value;
+  int percent;
+  if (!strcmp(query, "$")) {
+    target = E.numrows - 1;
+  }
+  else if (!editorGotoParse(query, &value, &percent)) {
+    free(query);
+    return;
+  }
+  else if (percent) {
+    target = (int)((E.numrows - 1) * value / 100);
+  }
+  else {
+    target = value > E.numrows ? E.numrows - 1 : (int)value - 1;
+  }
+  free(query);
+
+  // put the cursor at the start of the row and center
+  // the window on it in one step
+  //
+  E.cy = target;
+  E.cx = 0;
+  E.rowoff = editorLayoutLineOfRow(target) - E.screenrows / 2;
+  if (E.rowoff < 0) {
+    E.rowoff = 0;
+  }
+}
+
+int editorGotoParse(const char *query, long long *value, int *percent) {
+
+  // a line number counting from one or a percentage of
+  // the file and nothing after it, anything else is
+  // reported and left alone
+  //
+  if (!isdigit((unsigned char)query[0])) {
+    editorSetStatusMessage("Not a line number: %s", query);
+    return 0;
+  }
+  char *end;
+  errno = 0;
+  long long n = strtoll(query, &end, 10);
+  *percent = (*end == '%');
+  if (*percent) {
+    end++;
+  }
+  if (*end != '\0') {
+    editorSetStatusMessage("Not a line number: %s", query);
+    return 0;
+  }
+  if (errno == ERANGE || (*percent && n > 100) || (!*percent && n < 1)) {
+    editorSetStatusMessage("Out of range: %s", query);
+    return 0;
+  }
+  *value = n;
+  return 1;
+}
+
+int editorCursorLine() {
+
+  // visual line of the cursor, past the end of the
+  // file sits on the line after the last one
+  //
+  if (E.cy >= E.numrows) {
+    return editorLayoutTotal();
+  }
+  int line = editorLayoutLineOfRow(E.cy);
+  if (E.wrap) {
+    line += E.rx / editorWrapWidth();
+  }
+  return line;
+}
+
+void editorFindCallback(char *query, int key) {
+  
+  static char *match=NULL;
+
+  // direction to search
+  //
+  int direction = 1;
+
+  // current line
+  //
+  int check_line = E.cy;
+  int i = check_line;
+  erow *row = &E.row[i];
+  
+  
+
+  // rendering the row again moves it, the match
+  // stays at the same place within it
+  //
+  if(match) {
+    int off = match - row->render;
+    editorUpdateRow(row);
+    match = row->render + off;
+  }
+
+  //if enter or escape return
+  //
+  if (key == '\x1b' || key == '\r') {
+    // reset so the next search starts fresh
+    //
+    match = NULL;
+    direction = 1;
+    return;
+  }
+  // set search forwards
+  //
+  else if (key == ARROW_DOWN) {
+    direction = 1;
+  } 
+  // set search backwards
+  //
+  else if (key == ARROW_UP) {
+    direction = -1;
+  }
+  else {
+    goto label;
+  }
+
+  
+  
+  if(match!=NULL && query && row->render) {
+    char *match2 = strstr(match+1,query);
+    if(match2 != NULL) {
+      E.cy = i;
+      E.cx = match2 - row->render;
+      E.cx =  editorRowRxToCx(row, E.cx);
+      match = match2;
+      check_line = i;
+      goto label;
+    }
+    i+=direction;
+  }
+
+  int tries = 0;
+  while(1) {
+
+    // give up once every row was looked at
+    //
+    if (E.numrows == 0 || ++tries > E.numrows + 1) {
+      match = NULL;
+      goto label;
+    }
+
+    // the viewer carries on in the file past the
+    // loaded rows instead of wrapping around
+    //
+    if (E.view.active && (i >= E.numrows || i == -1)) {
+      if (query == NULL || !editorViewFind(query, direction)) {
+        editorSetStatusMessage("No more matches");
+        match = NULL;
+        goto label;
+      }
+      row = &E.row[E.cy];
+      match = row->render + editorRowCxToRx(row, E.cx);
+      goto label;
+    }
+    if(i >= E.numrows) {
+      i = 0;
+    }
+    if(i == -1) {
+      i = E.numrows - 1;
+    }
+
+    row = &E.row[i];
+    editorRowFill(row);
+    if(query && row->render) {
+      match = strstr(row->render,query);
+    }
+    if(match) {
+      E.cy = i;
+      E.cx = match - row->render;
+      E.cx =  editorRowRxToCx(row, E.cx);
+      check_line = i;
+      goto label;
+    }
+    i+=direction;
+    
+
+  }
+  label:
+  if(match!=NULL && E.cx + (int)strlen(query) <= row->rsize) {
+    memset(&row->hl[E.cx],HL_MATCH,strlen(query));
+    editorPanesTouch(row->idx, row->idx);
+  }
+}
+
+void editorFind() {
+
+  // save current cursor position
+  //
+  int saved_cx = E.cx;
+  int saved_cy = E.cy;
+  int saved_coloff = E.coloff;
+  int saved_rowoff = E.rowoff;
+
+  // prompt the user
+  //
+  char *query = editorPrompt("Search: %s (ESC to cancel) (UP/DOWN to search)", editorFindCallback);
+
+  // manage memory
+  //
+  if (query) {
+    free(query);
+  }
+
+  // // if query is null then restore cursor position
+  // //
+  // else {
+  //   E.cx = saved_cx;
+  //   E.cy = saved_cy;
+  //   E.coloff = saved_coloff;
+  //   E.rowoff = saved_rowoff;
+  // }
+
+}
+
+void editorMoveCursorBeginRow() {
+  E.cx = 0;
+}
+
+void editorMoveCursorEndRow() {
+  erow *row = &E.row[E.cy];
+  E.cx = row->size;
+}
+
+void editorMoveCursorLeftWord() {
+
+  erow *row = &E.row[E.cy];
+  char* curr = row->chars;
+
+  if (E.cx == 0) {
+    if (E.cy == 0) {
+      return;
+    }
+    else {
+      E.cy--;
+      row = &E.row[E.cy];
+      E.cx = row->size;
+      return;
+    }
+  }
+  if (curr[E.cx] == ' ' || curr[E.cx] == '\t') {
+    if (curr[E.cx-1] != ' ' && curr[E.cx-1] != '\t'){
+      E.cx--;
+    }
+    else {
+      while (curr[E.cx] == ' ' || curr[E.cx] == '\t') {
+        if (E.cx == 0){
+          return;
+        }
+        E.cx--;
+      }
+      E.cx++;
+      return;
+    }
+  }
+  
+  if (curr[E.cx] != ' ' && curr[E.cx] != '\t') {
+    if (curr[E.cx-1] == ' ' || curr[E.cx-1] == '\t'){
+        while (curr[E.cx] == ' ' || curr[E.cx] == '\t') {
+          if (E.cx == 0){
+            return;
+          }
+          E.cx--;
+        }
+        if (E.cx == 0){
+            return;
+        }
+        E.cx--;
+        return;
+      }
+    else{
+      while (curr[E.cx] != ' ' && curr[E.cx] != '\t') {
+        if (E.cx == 0) {
+          return;
+        }
+        E.cx--;
+      }
+      E.cx++;
+      return;
+    }
+  }
+}
+
+void editorMoveCursorRightWord() {
+  erow *row = &E.row[E.cy];
+  char* curr = row->chars;
+
+  if (E.cx == row->size) {
+    if (E.cy == E.numrows) {
+      return;
+    }
+    else {
+      E.cy++;
+      row = &E.row[E.cy];
+      E.cx = 0;
+      return;
+    }
+  }
+
+  if (curr[E.cx] == ' ' || curr[E.cx] == '\t') {
+    if (curr[E.cx+1] != ' ' && curr[E.cx+1] != '\t'){
+      E.cx++;
+    }
+    else {
+      while (curr[E.cx] == ' ' || curr[E.cx] == '\t') {
+        if (E.cx == row->size){
+          return;
+        }
+        E.cx++;
+      }
+      return;
+    }
+  }
+
+  if (curr[E.cx] != ' ' && curr[E.cx] != '\t') {
+    if (curr[E.cx+1] == ' ' || curr[E.cx+1] == '\t'){
+        while (curr[E.cx] == ' ' || curr[E.cx] == '\t') {
+          if (E.cx == row->size){
+            return;
+          }
+          E.cx++;
+        }
+        return;
+      }
+    else{
+      while (curr[E.cx] != ' ' && curr[E.cx] != '\t') {
+        if (E.cx == row->size) {
+          return;
+        }
+        E.cx++;
+      }
+      return;
+    }
+  }
+}
+
+/* End Cursor Actions*/
+
+
+
+/* Multiple Cursors */
+
+void editorCursorsTouch() {
+
+  // the rows the cursors are drawn on have to
+  // be drawn again when they move
+  //
+  if (E.cursors.n > 0) {
+    editorPanesTouch(E.cursors.c[0].cy, E.cursors.c[E.cursors.n - 1].cy);
+  }
+}
+
+void editorCursorsClear() {
+
+  // back to just the main cursor
+  //
+  editorCursorsTouch();
+  E.cursors.n = 0;
+}
+
+int editorCursorCompare(const void *a, const void *b) {
+  const struct editorCursor *x = a;
+  const struct editorCursor *y = b;
+  if (x->cy != y->cy) {
+    return x->cy < y->cy ? -1 : 1;
+  }
+  return (x->cx > y->cx) - (x->cx < y->cx);
+}
+
+void editorCursorsSort() {
+  struct editorCursors *cs = &E.cursors;
+
+  // sort, merge cursors that ended up in the same
+  // place and find the main one again
+  //
+  struct editorCursor main = {E.cx, E.cy};
+  qsort(cs->c, cs->n, sizeof(struct editorCursor), editorCursorCompare);
+  int n = 0;
+  for (int i = 0; i < cs->n; i++) {
+    if (n > 0 && editorCursorCompare(&cs->c[n - 1], &cs->c[i]) == 0) {
+      continue;
+    }
+    cs->c[n++] = cs->c[i];
+  }
+  cs->n = n;
+  cs->main = 0;
+  for (int i = 0; i < n; i++) {
+    if (editorCursorCompare(&cs->c[i], &main) == 0) {
+      cs->main = i;
+    }
+  }
+
+  // a single cursor left is just the main one
+  //
+  if (cs->n == 1) {
+    cs->n = 0;
+  }
+}
+
+void editorCursorsAdd(int cy, int cx) {
+  struct editorCursors *cs = &E.cursors;
+  if (cy < 0 || cy >= E.numrows || cs->n >= KILO_MAX_CURSORS) {
+    return;
+  }
+
+  // the main cursor is the first one
+  //
+  if (cs->n == 0 && E.cy < E.numrows) {
+    cs->cap = cs->cap ? cs->cap : 16;
+    cs->c = realloc(cs->c, sizeof(struct editorCursor) * cs->cap);
+    cs->c[cs->n].cx = E.cx;
+    cs->c[cs->n].cy = E.cy;
+    cs->n++;
+  }
+  if (cs->n == cs->cap) {
+    cs->cap = cs->cap ? cs->cap * 2 : 16;
+    cs->c = realloc(cs->c, sizeof(struct editorCursor) * cs->cap);
+  }
+  cs->c[cs->n].cx = cx;
+  cs->c[cs->n].cy = cy;
+  cs->n++;
+}
+
+void editorCursorsFind() {
+
+  // a cursor at the start of every match
+  //
+  char *query = editorPrompt("Cursors at: %s (ESC to cancel)", NULL);
+  if (query == NULL) {
+    return;
+  }
+  int len = strlen(query);
+  editorCursorsClear();
+  if (E.cy >= E.numrows && E.numrows > 0) {
+    E.cy = E.numrows - 1;
+    E.cx = E.row[E.cy].size;
+  }
+  for (int j = 0; j < E.numrows && len > 0; j++) {
+    erow *row = &E.row[j];
+    char *p = row->chars;
+    while ((p = memmem(p, row->chars + row->size - p, query, len)) != NULL) {
+      editorCursorsAdd(j, p - row->chars);
+      p += len;
+    }
+  }
+  free(query);
+
+  // the main cursor moves to the first match from where
+  // it was, the place it came from is not kept
+  //
+  if (E.cursors.n > 1) {
+    struct editorCursor from = E.cursors.c[0];
+    int first = 1;
+    while (first < E.cursors.n && editorCursorCompare(&E.cursors.c[first], &from) < 0) {
+      first++;
+    }
+    if (first == E.cursors.n) {
+      first = 1;
+    }
+    E.cx = E.cursors.c[first].cx;
+    E.cy = E.cursors.c[first].cy;
+    E.cursors.c[0] = E.cursors.c[first];
+  }
+  editorCursorsSort();
+  editorCursorsTouch();
+  editorSetStatusMessage("%d cursors", E.cursors.n ? E.cursors.n : 1);
+}
+
+void editorCursorsBelow() {
+
+  // another cursor on the row under the last one, as
+  // far along as the row allows
+  //
+  int cy = E.cursors.n ? E.cursors.c[E.cursors.n - 1].cy : E.cy;
+  int cx = E.cursors.n ? E.cursors.c[E.cursors.n - 1].cx : E.cx;
+  if (cy + 1 >= E.numrows) {
+    return;
+  }
+  if (cx > E.row[cy + 1].size) {
+    cx = E.row[cy + 1].size;
+  }
+  editorCursorsAdd(cy + 1, cx);
+  editorCursorsSort();
+  editorCursorsTouch();
+}
+
+void editorCursorsEdit(int key) {
+  struct editorCursors *cs = &E.cursors;
+  int *at = malloc(sizeof(int) * cs->n);
+
+  // every row with cursors on it is changed once, the
+  // cursors are sorted so those of a row are together
+  //
+  for (int i = 0; i < cs->n; ) {
+    int cy = cs->c[i].cy;
+    int end = i;
+    while (end < cs->n && cs->c[end].cy == cy) {
+      end++;
+    }
+    erow *row = &E.row[cy];
+
+    // the positions that change, a cursor at the start
+    // of the row has nothing to delete behind it and one
+    // at the end nothing in front of it
+    //
+    int n = 0;
+    for (int k = i; k < end; k++) {
+      int cx = cs->c[k].cx > row->size ? row->size : cs->c[k].cx;
+      cs->c[k].cx = cx;
+      if (key == BACKSPACE && cx > 0) {
+        at[n++] = cx - 1;
+      }
+      else if (key == DEL_KEY && cx < row->size) {
+        at[n++] = cx;
+      }
+      else if (key != BACKSPACE && key != DEL_KEY) {
+        at[n++] = cx;
+      }
+    }
+    if (n == 0) {
+      i = end;
+      continue;
+    }
+
+    // every cursor moves by what changed before it
+    //
+    int insert = (key != BACKSPACE && key != DEL_KEY);
+    int m = 0;
+    for (int k = i; k < end; k++) {
+      int cx = cs->c[k].cx;
+      while (m < n && (insert ? at[m] <= cx : at[m] < cx)) {
+        m++;
+      }
+      cs->c[k].cx = insert ? cx + m : cx - m;
+    }
+    if (insert) {
+      editorRowInsertChars(row, at, n, key);
+    }
+    else {
+      editorRowDelChars(row, at, n);
+    }
+    i = end;
+  }
+  free(at);
+}
+
+void editorCursorsMove(int key) {
+
+  // every cursor moves along its own row
+  //
+  for (int i = 0; i < E.cursors.n; i++) {
+    struct editorCursor *c = &E.cursors.c[i];
+    int size = E.row[c->cy].size;
+    if (c->cx > size) {
+      c->cx = size;
+    }
+    if (key == ARROW_LEFT && c->cx > 0) {
+      c->cx--;
+    }
+    else if (key == ARROW_RIGHT && c->cx < size) {
+      c->cx++;
+    }
+    else if (key == HOME_KEY) {
+      c->cx = 0;
+    }
+    else if (key == END_KEY) {
+      c->cx = size;
+    }
+  }
+}
+
+int editorCursorsKey(int c) {
+  struct editorCursors *cs = &E.cursors;
+
+  // adding more cursors goes through as usual
+  //
+  if (c == CTRL_KEY('p') || c == (ARROW_DOWN | KEY_CTRL)) {
+    return 0;
+  }
+
+  // typing, deleting and moving along the row happen at
+  // every cursor, escape drops the others and anything
+  // else leaves the main cursor to do it alone
+  //
+  int edit = (c == '\t' || (c >= 32 && c < 256 && c != BACKSPACE) || c == BACKSPACE || c == DEL_KEY);
+  int move = (c == ARROW_LEFT || c == ARROW_RIGHT || c == HOME_KEY || c == END_KEY);
+  if (!edit && !move) {
+    editorCursorsClear();
+    return c == '\x1b';
+  }
+
+  // rows may have gone away under the cursors
+  //
+  while (cs->n > 0 && cs->c[cs->n - 1].cy >= E.numrows) {
+    cs->n--;
+  }
+  if (cs->main >= cs->n) {
+    editorCursorsClear();
+    return 0;
+  }
+  cs->c[cs->main].cx = E.cx;
+  cs->c[cs->main].cy = E.cy;
+
+  editorCursorsTouch();
+  if (edit) {
+    editorCursorsEdit(c);
+  }
+  else {
+    editorCursorsMove(c);
+  }
+  E.cx = cs->c[cs->main].cx;
+  E.cy = cs->c[cs->main].cy;
+  editorCursorsSort();
+  editorCursorsTouch();
+  return 1;
+}
+
+void editorCursorsDraw(struct abuf *ab) {
+
+  // the cursors other than the main one in inverted
+  // colors wherever they are on the active pane
+  //
+  for (int i = 0; i < E.cursors.n; i++) {
+    struct editorCursor *c = &E.cursors.c[i];
+    if (i == E.cursors.main || c->cy >= E.numrows || editorFoldHidden(c->cy)) {
+      continue;
+    }
+    erow *row = &E.row[c->cy];
+    editorRowFill(row);
+    int rx = editorRowCxToRx(row, c->cx);
+    int line = editorLayoutLineOfRow(c->cy);
+    int col = rx - E.coloff;
+    if (E.wrap) {
+      line += rx / editorWrapWidth();
+      col = rx % editorWrapWidth();
+    }
+    if (line < E.rowoff || line >= E.rowoff + E.screenrows || col < 0 || col >= E.screencols) {
+      continue;
+    }
+    char buf[32];
+    int len = snprintf(buf, sizeof(buf), "\x1b[%d;%dH\x1b[7m%c\x1b[m", E.screentop + line - E.rowoff + 1,
+      E.screenleft + col + 1, rx < row->rsize ? row->render[rx] : ' ');
+    abAppend(ab, buf, len);
+  }
+}
+
+/* End Multiple Cursors */
+
+
+
+/* Selection and Clipboard */
+
+void editorSelectionToggle() {
+
+  // start selecting at the cursor, or
+  // stop when already selecting
+  //
+  if (E.sel.active) {
+    editorSelectionClear();
+    return;
+  }
+  E.sel.active = 1;
+  E.sel.ay = E.sel.ey = E.cy;
+  E.sel.ax = E.sel.ex = E.cx;
+  editorSetStatusMessage("Selecting");
+}
+
+void editorSelectionClear() {
+  if (!E.sel.active) {
+    return;
+  }
+  E.sel.active = 0;
+  editorPanesTouch(E.sel.ay < E.sel.ey ? E.sel.ay : E.sel.ey, E.sel.ay < E.sel.ey ? E.sel.ey : E.sel.ay);
+}
+
+void editorSelectionUpdate() {
+
+  // the rows between where the cursor was and where
+  // it is now went in or out of the selection
+  //
+  if (!E.sel.active || (E.sel.ey == E.cy && E.sel.ex == E.cx)) {
+    return;
+  }
+  editorPanesTouch(E.sel.ey < E.cy ? E.sel.ey : E.cy, E.sel.ey < E.cy ? E.cy : E.sel.ey);
+  E.sel.ey = E.cy;
+  E.sel.ex = E.cx;
+}
+
+int editorSelectionRange(int *y1, int *x1, int *y2, int *x2) {
+
+  // the ends of the selection in order, kept on the
+  // rows and characters there are
+  //
+  if (!E.sel.active || E.numrows == 0) {
+    return 0;
+  }
+  int ay = E.sel.ay, ax = E.sel.ax;
+  int ey = E.cy, ex = E.cx;
+  if (ay > ey || (ay == ey && ax > ex)) {
+    ay = E.cy, ax = E.cx;
+    ey = E.sel.ay, ex = E.sel.ax;
+  }
+  if (ay >= E.numrows) {
+    ay = E.numrows - 1;
+    ax = E.row[ay].size;
+  }
+  if (ey >= E.numrows) {
+    ey = E.numrows - 1;
+    ex = E.row[ey].size;
+  }
+  *y1 = ay;
+  *x1 = ax < E.row[ay].size ? ax : E.row[ay].size;
+  *y2 = ey;
+  *x2 = ex < E.row[ey].size ? ex : E.row[ey].size;
+  return *y1 != *y2 || *x1 != *x2;
+}
+
+int editorSelectionColumns(erow *row, int *from, int *to) {
+
+  // the columns of the row that are selected
+  //
+  int y1, x1, y2, x2;
+  if (!editorSelectionRange(&y1, &x1, &y2, &x2) || row->idx < y1 || row->idx > y2) {
+    return 0;
+  }
+  *from = row->idx == y1 ? editorRowCxToRx(row, x1) : 0;
+  *to = row->idx == y2 ? editorRowCxToRx(row, x2) : row->rsize;
+  return 1;
+}
+
+int editorSelectionKeeps(int c) {
+
+  // moving the cursor changes the selection and what is
+  // done with it ends it, anything else drops it first
+  //
+  switch (c) {
+    case ARROW_UP:
+    case ARROW_DOWN:
+    case ARROW_LEFT:
+    case ARROW_RIGHT:
+    case ARROW_LEFT | KEY_CTRL:
+    case ARROW_RIGHT | KEY_CTRL:
+    case PAGE_UP:
+    case PAGE_DOWN:
+    case CTRL_KEY('a'):
+    case CTRL_KEY('e'):
+    case CTRL_KEY('@'):
+    case CTRL_KEY('c'):
+    case CTRL_KEY('x'):
+    case CTRL_KEY('p'):
+      return 1;
+  }
+  return 0;
+}
+
+void editorSelectionCursors() {
+
+  // a cursor on every selected row as far
+  // along as the cursor is
+  //
+  int y1, x1, y2, x2;
+  if (!editorSelectionRange(&y1, &x1, &y2, &x2)) {
+    editorSelectionClear();
+    return;
+  }
+  editorSelectionClear();
+  editorCursorsClear();
+  for (int j = y1; j <= y2; j++) {
+    editorCursorsAdd(j, E.cx < E.row[j].size ? E.cx : E.row[j].size);
+  }
+  editorCursorsSort();
+  editorCursorsTouch();
+  editorSetStatusMessage("%d cursors", E.cursors.n ? E.cursors.n : 1);
+}
+
+void editorClipboardFree() {
+  for (int i = 0; i < E.clip.n; i++) {
+    editorTextRelease(E.clip.lines[i].text);
+  }
+  free(E.clip.lines);
+  E.clip.lines = NULL;
+  E.clip.n = 0;
+}
+
+void editorCopy() {
+
+  // the clipboard holds on to the text of the rows
+  // instead of copying it, a row that changes later
+  // makes its own copy then
+  //
+  int y1, x1, y2, x2;
+  if (!editorSelectionRange(&y1, &x1, &y2, &x2)) {
+    editorSelectionClear();
+    return;
+  }
+  editorClipboardFree();
+  E.clip.n = y2 - y1 + 1;
+  E.clip.lines = malloc(sizeof(struct editorSlice) * E.clip.n);
+  for (int j = y1; j <= y2; j++) {
+    struct editorSlice *l = &E.clip.lines[j - y1];
+    l->text = editorTextRetain(E.row[j].chars);
+    l->off = j == y1 ? x1 : 0;
+    l->len = (j == y2 ? x2 : E.row[j].size) - l->off;
+    l->shared = (l->off == 0 && l->len == E.row[j].size);
+  }
+  editorSelectionClear();
+  editorSetStatusMessage("Copied %d line%s", E.clip.n, E.clip.n == 1 ? "" : "s");
+}
+
+void editorCut() {
+  int y1, x1, y2, x2;
+  if (!editorSelectionRange(&y1, &x1, &y2, &x2)) {
+    editorSelectionClear();
+    return;
+  }
+  editorCopy();
+
+  // the first row keeps what is before the selection and
+  // gets what is after it on the last row, the rows in
+  // between go in one piece
+  //
+  erow *row = &E.row[y1];
+  erow *last = &E.row[y2];
+  editorRowReserve(row, 0);
+  if (y1 == y2) {
+    memmove(&row->chars[x1], &row->chars[x2], row->size - x2 + 1);
+    row->size -= x2 - x1;
+    editorUpdateRow(row);
+    E.dirty++;
+  }
+  else {
+    row->size = x1;
+    row->chars[x1] = '\0';
+    editorRowAppendString(row, &last->chars[x2], last->size - x2);
+    editorDelRows(y1 + 1, y2 + 1);
+  }
+  E.cy = y1;
+  E.cx = x1;
+}
+
+void editorPaste() {
+  struct editorClipboard *clip = &E.clip;
+  if (clip->n == 0) {
+    return;
+  }
+  if (E.cy == E.numrows) {
+    editorInsertRow(E.numrows, "", 0);
+  }
+  erow *row = &E.row[E.cy];
+  struct editorSlice *first = &clip->lines[0];
+  struct editorSlice *last = &clip->lines[clip->n - 1];
+
+  // within a row the text goes in where the cursor is
+  //
+  if (clip->n == 1) {
+    editorRowInsertString(row, E.cx, first->text + first->off, first->len);
+    E.cx += first->len;
+    return;
+  }
+
+  // otherwise the row is split at the cursor, the last line
+  // goes in front of the part after the cursor
+  //
+  int tail = row->size - E.cx;
+  char *text = malloc(last->len + tail + 1);
+  memcpy(text, last->text + last->off, last->len);
+  memcpy(text + last->len, &row->chars[E.cx], tail);
+  struct editorSlice end = {editorTextAlloc(text, last->len + tail), 0, last->len + tail, 1};
+  free(text);
+
+  editorRowReserve(row, 0);
+  row->size = E.cx;
+  row->chars[E.cx] = '\0';
+  editorRowAppendString(row, first->text + first->off, first->len);
+
+  // the whole rows in between share the text on the
+  // clipboard and go in together with the last one
+  //
+  struct editorSlice saved = *last;
+  *last = end;
+  editorInsertRows(E.cy + 1, &clip->lines[1], clip->n - 1);
+  *last = saved;
+  editorTextRelease(end.text);
+  E.cy += clip->n - 1;
+  E.cx = last->len;
+}
+
+/* End Selection and Clipboard */
+
+
+
+/* Editor Initialization and File Handline */
+
+void initEditor() {
+
+  // start with a single empty buffer
+  //
+  editorBufferReset();
+  E.buffers = malloc(sizeof(struct editorBuffer));
+  E.numbuffers = 1;
+  E.curbuf = 0;
+  E.buftick = 0;
+
+  // set the status message a null terminating character
+  // and set the time to zero
+  //
+  E.statusmsg[0] = '\0';
+  E.statusmsg_time = 0;
+
+  // if getting window size fails error
+  //
+  if (E.term->size(&E.termrows, &E.termcols) == -1){
+    die("getWindowSize");
+  }
+
+  // deal with the last line so no text
+  // is displayed on the bottom bar
+  // to compensate for the help bar
+  //
+  E.termrows -= 2;
+
+  // start with one pane covering the text area
+  //
+  E.numpanes = 1;
+  E.curpane = 0;
+  E.split = SPLIT_NONE;
+  memset(E.panes, 0, sizeof(E.panes));
+  editorPanesLayout();
+
+  // start without soft wrapping
+  //
+  E.wrap = 0;
+
+  // nothing watches the files until that is started
+  //
+  E.watch = -1;
+  E.events.timer = -1;
+  E.events.signal = -1;
+}
+
+void editorOpen(char* filename) {
+
+  // free the current memory of the filename
+  // and copy the one trying to be opened
+  //
+  free(E.filename);
+  E.filename = strdup(filename);
+
+  editorSelectSyntaxHighlight();
+
+  // open the file for reading
+  //
+  FILE *fp = fopen(filename, "r");
+  
+  // if file failed to open then
+  // die
+  //
+  if (!fp) {
+    die("fopen");
+  }
+  
+  // set a NULL ptr to a character array
+  //
+  char *line = NULL;
+  
+  // initialize the line capacity
+  // and the length of the line
+  //
+  size_t linecap = 0;
+  ssize_t linelen;
+
+  // readin the line length and the line capacity
+  // from the file
+  //
+  linelen = getline(&line, &linecap, fp);
+
+  // show the text first and leave the colors
+  // to the background highlighter
+  //
+  E.hl_defer = 1;
+
+  /** This is my contribution **/
+
+  // it fixes an error with not printing the first line
+  //
+  editorInsertRow(E.numrows, line, linelen-1);
+
+  /* End my contribution */
+
+  // if the line isn't empty
+  //
+  while ((linelen = getline(&line, &linecap, fp)) != -1) {
+
+    // iterate through all the characters in the line
+    //
+    while (linelen > 0 && (line[linelen - 1] == '\n' || line[linelen - 1] == '\r')) {
+      linelen--;
+    }
+
+    // write the line
+    //
+    editorInsertRow(E.numrows,line, linelen);
+
+  }
+  // free up the character array holding the line
+  // and close the file
+  //
+  free(line);
+  fclose(fp);
+  E.hl_defer = 0;
+
+  // a file without a known extension may name
+  // its interpreter on the first line
+  //
+  if (E.syntax == NULL) {
+    editorSelectSyntaxHighlight();
+  }
+
+  // remember what was read as unmodified
+  // and notice when someone else changes the file
+  //
+  editorHashSave();
+  editorDiskWatch();
+  
+}
+
+void editorSave() {
+
+  // if there is no filename break
+  // prompt the user for a file name
+  //
+  if (E.filename == NULL) {
+    E.filename = editorPrompt("Save as: %s (ESC to cancel)", NULL);
+    if (E.filename == NULL) {
+      editorSetStatusMessage("Save aborted");
+      return;
+    }
+  }
+
+  // integer for keeping track of the length of the file
+  //
+  int len;
+
+  // get the pointer to the beginning of the string
+  //
+  char *buf = editorRowsToString(&len);
+
+  // O_RDWR = open for reading and writing
+  // O_CREAT = create a file if it doesn't exist 
+  // 0644 is the standard permissions to save files
+  //
+  int fd = open(E.filename, O_RDWR | O_CREAT, 0644);
+  if (fd != -1) {
+
+    // sets file size
+    //
+    if (ftruncate(fd, len) != -1) {
+
+      // writes to the file
+      //
+      if (write(fd, buf, len) == len) {  
+  
+        // closes the file
+        //
+        close(fd);
+
+        // frees the memory storing the string
+        //
+        free(buf);
+        
+        // reset modification counter
+        // and set saved messaged
+        //
+        editorHashSave();
+        editorDiskWatch();
+        editorSetStatusMessage("%d bytes written to disk", len);
+
+        return;
+      }
+      editorSelectSyntaxHighlight();
+    }
+    close(fd);
+  }
+  free(buf);
+  editorSetStatusMessage("Can't save! I/O error: %s", strerror(errno));
+}
+
+char *editorRowsToString (int *buflen) {
+
+  // total length of the string
+  //
+  int totlen = 0;
+
+  // index integer
+  //
+  int j;
+  for (j = 0; j < E.numrows; j++)
+
+    // set the total length to the size of the row + 
+    // the new line character
+    //
+    totlen += E.row[j].size + 1;
+
+  // set the length to include the new line character
+  //
+  *buflen = totlen;
+
+  // allocate memory equal to the length of the desired string
+  //
+  char *buf = malloc(totlen);
+
+  // declare pointer to the return string
+  //
+  char *p = buf;
+
+  // iterate through each row
+  //
+  for (j = 0; j < E.numrows; j++) {
+
+    // copy the row into the poitner
+    //
+    memcpy(p, E.row[j].chars, E.row[j].size);
+
+    // set the pointer to the end of the string
+    //
+    p += E.row[j].size;
+
+    // add a new line character to the end of the string and iterate past
+    //
+    *p = '\n';
+    p++;
   }
+
+  // return the pointer to the beginning of the string
+  //
+  return buf;
 }
 
-void editorMoveCursorRightWord() {
-  erow *row = &E.row[E.cy];
-  char* curr = row->chars;
+char *editorPrompt(char *prompt, void (*callback)(char *, int)) {
 
-  if (E.cx == row->size) {
-    if (E.cy == E.numrows) {
-      return;
-    }
-    else {
-      E.cy++;
-      row = &E.row[E.cy];
-      E.cx = 0;
-      return;
-    }
-  }
+  // set size of the buffer
+  //
+  size_t bufsize = 128;
+  
+  // allocate appropriat memory
+  //
+  char *buf = malloc(bufsize);
+  
+  // set the length of the buffer
+  //
+  size_t buflen = 0;
+  
+  // set the beginning of the buffer to be a null
+  // terminating character
+  //
+  buf[0] = '\0';
 
-  if (curr[E.cx] == ' ' || curr[E.cx] == '\t') {
-    if (curr[E.cx+1] != ' ' && curr[E.cx+1] != '\t'){
-      E.cx++;
+  // loop until proper key is read
+  //
+  while (1) {
+
+    // set message at bottom bar
+    //
+    editorSetStatusMessage(prompt, buf);
+
+    // update viewing screen
+    //
+    editorRefreshScreen();
+    
+    // read key presses
+    //
+    int c = editorReadKey();
+
+    // allow user to backspace
+    //
+    if (c == BACKSPACE) {
+      if (buflen != 0) {
+         buf[--buflen] = '\0';
+      }
     }
-    else {
-      while (curr[E.cx] == ' ' || curr[E.cx] == '\t') {
-        if (E.cx == row->size){
-          return;
-        }
-        E.cx++;
+
+    // if escape is pressed
+    // cancel the prompt
+    //
+    else if (c == '\x1b') {
+      editorSetStatusMessage("");
+
+
+      if (callback) {
+        callback(buf, c);
       }
-      return;
+      free(buf);
+      return NULL;
     }
-  }
 
-  if (curr[E.cx] != ' ' && curr[E.cx] != '\t') {
-    if (curr[E.cx+1] == ' ' || curr[E.cx+1] == '\t'){
-        while (curr[E.cx] == ' ' || curr[E.cx] == '\t') {
-          if (E.cx == row->size){
-            return;
-          }
-          E.cx++;
+    // if character press is enter
+    //
+    else if (c == '\r') {
+
+      // confirm their input is not empty
+      // and return
+      //
+      if (buflen != 0) {
+        editorSetStatusMessage("");
+        if (callback) {
+          callback(buf, c);
         }
-        return;
+        return buf;
       }
-    else{
-      while (curr[E.cx] != ' ' && curr[E.cx] != '\t') {
-        if (E.cx == row->size) {
-          return;
-        }
-        E.cx++;
+    } 
+    // otherwise if they're not trying to cancel
+    // or select another special character
+    //
+    else if (!iscntrl(c) && c < 128) {
+
+      // if the bufflen is full
+      // increase the size by double
+      //
+      if (buflen == bufsize - 1) {
+        bufsize *= 2;
+        buf = realloc(buf, bufsize);
       }
-      return;
+
+      // add the character to the buf
+      // and also add a null terminating character
+      //
+      buf[buflen++] = c;
+      buf[buflen] = '\0';
+    }
+    if (callback) {
+      callback(buf, c);
     }
   }
 }
 
-/* End Cursor Actions*/
+/* End Editor Initialization and File Handline */
 
 
 
-/* Editor Initialization and File Handline */
+/* Buffer Actions */
+
+void editorBufferStash(struct editorBuffer *b) {
+
+  // copy the state of the open file out of the config
+  //
+  b->cx = E.cx;
+  b->cy = E.cy;
+  b->rx = E.rx;
+  b->rowoff = E.rowoff;
+  b->coloff = E.coloff;
+  b->numrows = E.numrows;
+  b->row = E.row;
+  b->filename = E.filename;
+  b->dirty = E.dirty;
+  b->syntax = E.syntax;
+  b->layout = E.layout;
+  b->hl_frontier = E.hl_frontier;
+  b->hl_ahead = E.hl_ahead;
+  b->symbols = E.symbols;
+  b->brackets = E.brackets;
+  b->folds = E.folds;
+  b->disk = E.disk;
+  b->hashes = E.hashes;
+}
+
+void editorBufferLoad(struct editorBuffer *b) {
+
+  // copy the state of the file back into the config
+  //
+  E.cx = b->cx;
+  E.cy = b->cy;
+  E.rx = b->rx;
+  E.rowoff = b->rowoff;
+  E.coloff = b->coloff;
+  E.numrows = b->numrows;
+  E.row = b->row;
+  E.filename = b->filename;
+  E.dirty = b->dirty;
+  E.syntax = b->syntax;
+  E.layout = b->layout;
+  E.hl_frontier = b->hl_frontier;
+  E.hl_ahead = b->hl_ahead;
+  E.symbols = b->symbols;
+  E.brackets = b->brackets;
+  E.folds = b->folds;
+  E.disk = b->disk;
+  E.hashes = b->hashes;
+}
+
+void editorBufferReset() {
 
-void initEditor() {
-  
   // set the cursor to the start point
+  // and the tab variable
   //
   E.cx = 0;
   E.cy = 0;
-
-  // set the tab variable
-  //
   E.rx = 0;
 
-  // set the row offset to the top of the screen
+  // set the row and column offsets to the
+  // top left of the file
   //
   E.rowoff = 0;
-
-  // set the column offset to the beginning
-  // of the row
-  //
   E.coloff = 0;
-  
-  // set the number of rows to zero
-  //
-  E.numrows = 0;
 
-  // set the array of rows to a null
+  // start with no rows
   //
+  E.numrows = 0;
   E.row = NULL;
-  
+
   // set the file's default to unedited
+  // with no name and no filetype
   //
   E.dirty = 0;
+  E.filename = NULL;
+  E.syntax = NULL;
 
-  // sett the filename character array to a null
+  // no wrap layout yet
   //
-  E.filename = NULL;
+  memset(&E.layout, 0, sizeof(E.layout));
 
-  // set the status message a null terminating character
-  // and set the time to zero
+  // nothing to highlight
   //
-  E.statusmsg[0] = '\0';
-  E.statusmsg_time = 0;
+  E.hl_frontier = 0;
+  E.hl_ahead = 0;
+  memset(&E.symbols, 0, sizeof(E.symbols));
+  memset(&E.brackets, 0, sizeof(E.brackets));
+  E.bracket_row = -1;
+  E.bracket_col = -1;
+  memset(&E.folds, 0, sizeof(E.folds));
 
-  // if getting window size fails error
+  // not watched on disk yet
   //
-  if (getWindowSize(&E.screenrows, &E.screencols) == -1){
-    die("getWindowSize");
+  memset(&E.disk, 0, sizeof(E.disk));
+  E.disk.wd = -1;
+
+  // an empty buffer is the saved state
+  //
+  memset(&E.hashes, 0, sizeof(E.hashes));
+  E.hashes.link = editorHashLink(0, 0);
+  E.hashes.saved_link = E.hashes.link;
+}
+
+void editorBufferNew() {
+
+  // put the current file away
+  //
+  editorBufferStash(&E.buffers[E.curbuf]);
+  E.buffers[E.curbuf].evicted = 0;
+  E.buffers[E.curbuf].lastused = ++E.buftick;
+
+  // add a slot at the end of the list and make
+  // it the current buffer
+  //
+  E.buffers = realloc(E.buffers, sizeof(struct editorBuffer) * (E.numbuffers + 1));
+  E.curbuf = E.numbuffers++;
+  editorBufferReset();
+  editorBufferEvictIdle();
+  editorPanesReset();
+}
+
+void editorBufferSwitch(int i) {
+
+  // check it is a different buffer
+  //
+  if (i < 0 || i >= E.numbuffers || i == E.curbuf) {
+    return;
   }
 
-  // deal with the last line so no text
-  // is displayed on the bottom bar
-  // to compensate for the help bar
+  // put the current file away
   //
-  E.screenrows -= 2;
+  editorBufferStash(&E.buffers[E.curbuf]);
+  E.buffers[E.curbuf].evicted = 0;
+  E.buffers[E.curbuf].lastused = ++E.buftick;
 
+  // bring the other one in
+  //
+  E.curbuf = i;
+  editorBufferLoad(&E.buffers[i]);
 
-  // set the default filetype to none
+  // if its caches were thrown away render the rows again,
+  // the text itself never left memory
   //
-  E.syntax = NULL;
+  if (E.buffers[i].evicted) {
+    E.hl_defer = 1;
+    for (int j = 0; j < E.numrows; j++) {
+      editorUpdateRow(&E.row[j]);
+    }
+    E.hl_defer = 0;
+    E.buffers[i].evicted = 0;
+  }
+  editorBufferEvictIdle();
+  editorPanesReset();
+
+  // a followed file catches up on what was
+  // written while it was in the background
+  //
+  if (E.follow.active && E.curbuf == E.follow.buf) {
+    editorFollowRead();
+  }
 
+  // so does a file that changed on disk
+  //
+  editorDiskCheck();
 
+  editorSetStatusMessage("Buffer %d/%d: %s", E.curbuf + 1, E.numbuffers, E.filename ? E.filename : "[No Name]");
 }
 
-void editorOpen(char* filename) {
+void editorBufferEvict(struct editorBuffer *b) {
+
+  // free the render and highlight caches of every row,
+  // they are rebuilt from the characters when the buffer
+  // is shown again
+  //
+  for (int j = 0; j < b->numrows; j++) {
+    free(b->row[j].render);
+    free(b->row[j].hl);
+    free(b->row[j].nodes);
+    free(b->row[j].defs);
+    b->row[j].render = NULL;
+    b->row[j].hl = NULL;
+    b->row[j].rsize = 0;
+    b->row[j].nodes = NULL;
+    b->row[j].nnodes = 0;
+    b->row[j].defs = NULL;
+    b->row[j].ndefs = 0;
+    b->row[j].ps_in = 0;
+    b->row[j].ps_out = 0;
+  }
 
-  // free the current memory of the filename
-  // and copy the one trying to be opened
+  // and so do the names defined in them
+  // and the bracket index
   //
-  free(E.filename);
-  E.filename = strdup(filename);
+  editorSymbolsFree(&b->symbols);
+  free(b->brackets.tree);
+  memset(&b->brackets, 0, sizeof(b->brackets));
 
-  editorSelectSyntaxHighlight();
+  // the wrap layout goes with the rows
+  //
+  free(b->layout.heights);
+  free(b->layout.tree);
+  memset(&b->layout, 0, sizeof(b->layout));
+  b->evicted = 1;
+}
 
-  // open the file for reading
+void editorBufferEvictIdle() {
+
+  // keep the caches of the most recently used background
+  // buffers and evict the rest
   //
-  FILE *fp = fopen(filename, "r");
-  
-  // if file failed to open then
-  // die
+  for (int i = 0; i < E.numbuffers; i++) {
+    if (i == E.curbuf || E.buffers[i].evicted) {
+      continue;
+    }
+
+    // count the background buffers used more recently
+    //
+    int newer = 0;
+    for (int j = 0; j < E.numbuffers; j++) {
+      if (j != E.curbuf && j != i && E.buffers[j].lastused > E.buffers[i].lastused) {
+        newer++;
+      }
+    }
+    if (newer >= KILO_RESIDENT_BUFFERS) {
+      editorBufferEvict(&E.buffers[i]);
+    }
+  }
+}
+
+void editorBufferOpen() {
+
+  // ask for the file
   //
-  if (!fp) {
-    die("fopen");
+  char *filename = editorPrompt("Open: %s (ESC to cancel)", NULL);
+  if (filename == NULL) {
+    return;
   }
-  
-  // set a NULL ptr to a character array
+
+  // switch to it if it is already open
   //
-  char *line = NULL;
-  
-  // initialize the line capacity
-  // and the length of the line
+  for (int i = 0; i < E.numbuffers; i++) {
+    char *name = (i == E.curbuf) ? E.filename : E.buffers[i].filename;
+    if (name && !strcmp(name, filename)) {
+      editorBufferSwitch(i);
+      free(filename);
+      return;
+    }
+  }
+
+  // load it into a new buffer, a file that doesn't
+  // exist yet starts out empty and is created on save
   //
-  size_t linecap = 0;
-  ssize_t linelen;
+  editorBufferNew();
+  if (access(filename, F_OK) == 0) {
+    editorOpen(filename);
+  }
+  else {
+    E.filename = strdup(filename);
+    editorSelectSyntaxHighlight();
+  }
+  free(filename);
+
+  editorSetStatusMessage("Buffer %d/%d: %s", E.curbuf + 1, E.numbuffers, E.filename);
+}
+
+void editorBufferClose() {
+
+  // free every row and the layout of the current file
+  //
+  for (int j = 0; j < E.numrows; j++) {
+    editorFreeRow(&E.row[j]);
+  }
+  free(E.row);
+  free(E.filename);
+  editorLayoutFree();
+  editorSymbolsFree(&E.symbols);
+  free(E.brackets.tree);
+  free(E.folds.f);
+  free(E.hashes.saved);
+
+  // stop watching it
+  //
+  editorDiskUnwatch();
+
+  // stop following it, or keep track of the
+  // followed one as slots move
+  //
+  if (E.follow.active && E.follow.buf == E.curbuf) {
+    editorFollowStop();
+  }
+  else if (E.follow.active && E.follow.buf > E.curbuf) {
+    E.follow.buf--;
+  }
+
+  // remove its slot from the list
+  //
+  memmove(&E.buffers[E.curbuf], &E.buffers[E.curbuf + 1], sizeof(struct editorBuffer) * (E.numbuffers - E.curbuf - 1));
+  E.numbuffers--;
 
-  // readin the line length and the line capacity
-  // from the file
+  // show the buffer that took its place
   //
-  linelen = getline(&line, &linecap, fp);
+  if (E.curbuf >= E.numbuffers) {
+    E.curbuf = E.numbuffers - 1;
+  }
+  struct editorBuffer *b = &E.buffers[E.curbuf];
+  editorBufferLoad(b);
+  if (b->evicted) {
+    E.hl_defer = 1;
+    for (int j = 0; j < E.numrows; j++) {
+      editorUpdateRow(&E.row[j]);
+    }
+    E.hl_defer = 0;
+    b->evicted = 0;
+  }
+  editorPanesReset();
 
-  /** This is my contribution **/
+  editorSetStatusMessage("Buffer %d/%d: %s", E.curbuf + 1, E.numbuffers, E.filename ? E.filename : "[No Name]");
+}
 
-  // it fixes an error with not printing the first line
-  //
-  editorInsertRow(E.numrows, line, linelen-1);
+/* End Buffer Actions */
 
-  /* End my contribution */
 
-  // if the line isn't empty
-  //
-  while ((linelen = getline(&line, &linecap, fp)) != -1) {
 
-    // iterate through all the characters in the line
-    //
-    while (linelen > 0 && (line[linelen - 1] == '\n' || line[linelen - 1] == '\r')) {
-      linelen--;
-    }
+/* Split Panes */
 
-    // write the line
-    //
-    editorInsertRow(E.numrows,line, linelen);
+void editorPaneStash(struct editorPane *p) {
 
-  }
-  // free up the character array holding the line
-  // and close the file
+  // copy the view out of the config
   //
-  free(line);
-  fclose(fp);
+  p->cx = E.cx;
+  p->cy = E.cy;
+  p->rx = E.rx;
+  p->rowoff = E.rowoff;
+  p->coloff = E.coloff;
+}
+
+void editorPaneLoad(struct editorPane *p) {
 
-  // reset the modification counter
+  // copy the view into the config
   //
-  E.dirty = 0;
-  
+  E.cx = p->cx;
+  E.cy = p->cy;
+  E.rx = p->rx;
+  E.rowoff = p->rowoff;
+  E.coloff = p->coloff;
+
+  // the pane becomes the screen everything
+  // else draws and scrolls within
+  //
+  E.screentop = p->top;
+  E.screenleft = p->left;
+  E.screenrows = p->rows;
+  E.screencols = p->cols;
 }
 
-void editorSave() {
+void editorPanesLayout() {
 
-  // if there is no filename break
-  // prompt the user for a file name
+  // index the panes
   //
-  if (E.filename == NULL) {
-    E.filename = editorPrompt("Save as: %s (ESC to cancel)", NULL);
-    if (E.filename == NULL) {
-      editorSetStatusMessage("Save aborted");
-      return;
-    }
+  struct editorPane *p = E.panes;
+
+  // start with the first pane covering everything
+  //
+  p[0].top = 0;
+  p[0].left = 0;
+  p[0].rows = E.termrows;
+  p[0].cols = E.termcols;
+
+  // stack the panes with a separator line between them
+  //
+  if (E.split == SPLIT_HORIZONTAL) {
+    p[0].rows = (E.termrows - 1) / 2;
+    p[1].top = p[0].rows + 1;
+    p[1].left = 0;
+    p[1].rows = E.termrows - p[0].rows - 1;
+    p[1].cols = E.termcols;
   }
 
-  // integer for keeping track of the length of the file
+  // put the panes side by side with a separator column, both
+  // get the same width so they wrap rows the same way
   //
-  int len;
+  else if (E.split == SPLIT_VERTICAL) {
+    p[0].cols = (E.termcols - 1) / 2;
+    p[1].top = 0;
+    p[1].left = p[0].cols + 1;
+    p[1].rows = E.termrows;
+    p[1].cols = p[0].cols;
+  }
 
-  // get the pointer to the beginning of the string
+  // every pane has to be drawn again
   //
-  char *buf = editorRowsToString(&len);
+  for (int i = 0; i < E.numpanes; i++) {
+    p[i].drawn = 0;
+  }
 
-  // O_RDWR = open for reading and writing
-  // O_CREAT = create a file if it doesn't exist 
-  // 0644 is the standard permissions to save files
+  // the active pane becomes the screen
   //
-  int fd = open(E.filename, O_RDWR | O_CREAT, 0644);
-  if (fd != -1) {
+  E.screentop = p[E.curpane].top;
+  E.screenleft = p[E.curpane].left;
+  E.screenrows = p[E.curpane].rows;
+  E.screencols = p[E.curpane].cols;
+}
 
-    // sets file size
-    //
-    if (ftruncate(fd, len) != -1) {
+void editorPanesReset() {
 
-      // writes to the file
-      //
-      if (write(fd, buf, len) == len) {  
-  
-        // closes the file
-        //
-        close(fd);
+  // point every pane at the view of the
+  // current buffer
+  //
+  for (int i = 0; i < E.numpanes; i++) {
+    editorPaneStash(&E.panes[i]);
+    E.panes[i].drawn = 0;
+  }
 
-        // frees the memory storing the string
-        //
-        free(buf);
-        
-        // reset modification counter
-        // and set saved messaged
-        //
-        E.dirty = 0;
-        editorSetStatusMessage("%d bytes written to disk", len);
+  // the selection and the other cursors were
+  // in the buffer that was showing
+  //
+  E.sel.active = 0;
+  E.cursors.n = 0;
+}
 
-        return;
-      }
-      editorSelectSyntaxHighlight();
+void editorPanesTouch(int lo, int hi) {
+
+  // grow the range of changed rows of every pane
+  //
+  for (int i = 0; i < E.numpanes; i++) {
+    struct editorPane *p = &E.panes[i];
+    if (!p->touched) {
+      p->touched = 1;
+      p->touched_lo = lo;
+      p->touched_hi = hi;
+      continue;
+    }
+    if (lo < p->touched_lo) {
+      p->touched_lo = lo;
+    }
+    if (hi > p->touched_hi) {
+      p->touched_hi = hi;
     }
-    close(fd);
   }
-  free(buf);
-  editorSetStatusMessage("Can't save! I/O error: %s", strerror(errno));
 }
 
-char *editorRowsToString (int *buflen) {
+void editorPaneSwitch() {
 
-  // total length of the string
+  // nothing to switch to
   //
-  int totlen = 0;
+  if (E.numpanes < 2) {
+    return;
+  }
 
-  // index integer
+  // swap the view of the active pane for the other one
   //
-  int j;
-  for (j = 0; j < E.numrows; j++)
-
-    // set the total length to the size of the row + 
-    // the new line character
-    //
-    totlen += E.row[j].size + 1;
+  editorPaneStash(&E.panes[E.curpane]);
+  E.curpane = (E.curpane + 1) % E.numpanes;
+  editorPaneLoad(&E.panes[E.curpane]);
 
-  // set the length to include the new line character
+  // the other pane may have rows taken out from under it
   //
-  *buflen = totlen;
+  if (E.cy > E.numrows) {
+    E.cy = E.numrows;
+  }
+  int rowlen = (E.cy < E.numrows) ? E.row[E.cy].size : 0;
+  if (E.cx > rowlen) {
+    E.cx = rowlen;
+  }
+}
 
-  // allocate memory equal to the length of the desired string
-  //
-  char *buf = malloc(totlen);
+void editorToggleSplit() {
 
-  // declare pointer to the return string
+  // the screen has to be big enough to hold two panes
   //
-  char *p = buf;
+  if (E.split == SPLIT_NONE && (E.termrows < 3 || E.termcols < 3)) {
+    editorSetStatusMessage("Window too small to split");
+    return;
+  }
 
-  // iterate through each row
+  // cycle from one pane to a horizontal split
+  // to a vertical split and back
   //
-  for (j = 0; j < E.numrows; j++) {
+  editorPaneStash(&E.panes[E.curpane]);
+  E.split = (E.split + 1) % 3;
 
-    // copy the row into the poitner
-    //
-    memcpy(p, E.row[j].chars, E.row[j].size);
-
-    // set the pointer to the end of the string
-    //
-    p += E.row[j].size;
+  // a new split starts out showing the same view
+  //
+  if (E.split == SPLIT_HORIZONTAL) {
+    E.panes[1] = E.panes[0];
+    E.numpanes = 2;
+  }
 
-    // add a new line character to the end of the string and iterate past
-    //
-    *p = '\n';
-    p++;
+  // going back to one pane keeps the active view
+  //
+  else if (E.split == SPLIT_NONE) {
+    E.panes[0] = E.panes[E.curpane];
+    E.numpanes = 1;
+    E.curpane = 0;
   }
 
-  // return the pointer to the beginning of the string
+  // lay out the panes and load the active one
   //
-  return buf;
+  editorPanesLayout();
+  editorPaneLoad(&E.panes[E.curpane]);
 }
 
-char *editorPrompt(char *prompt, void (*callback)(char *, int)) {
+int editorDrawPane(struct abuf *ab, struct editorPane *p) {
 
-  // set size of the buffer
+  // skip the pane if it shows the same part of the same
+  // buffer and none of the rows on it changed
   //
-  size_t bufsize = 128;
-  
-  // allocate appropriat memory
+  if (p->drawn && p->drawn_rowoff == E.rowoff && p->drawn_coloff == E.coloff && p->drawn_buf == E.curbuf && p->drawn_wrap == E.wrap) {
+    int sub;
+    int first = editorLayoutRowOfLine(E.rowoff, &sub);
+    int last = editorLayoutRowOfLine(E.rowoff + E.screenrows - 1, &sub);
+    if (!p->touched || p->touched_hi < first || p->touched_lo > last) {
+      p->touched = 0;
+      return 0;
+    }
+  }
+
+  // draw the rows of the pane
   //
-  char *buf = malloc(bufsize);
-  
-  // set the length of the buffer
+  editorDrawRows(ab);
+
+  // remember what the pane shows now
   //
-  size_t buflen = 0;
-  
-  // set the beginning of the buffer to be a null
-  // terminating character
+  p->drawn = 1;
+  p->drawn_rowoff = E.rowoff;
+  p->drawn_coloff = E.coloff;
+  p->drawn_buf = E.curbuf;
+  p->drawn_wrap = E.wrap;
+  p->touched = 0;
+  return 1;
+}
+
+void editorDrawSeparators(struct abuf *ab) {
+
+  // buffer for positioning the cursor
   //
-  buf[0] = '\0';
+  char pos[32];
+  int poslen;
 
-  // loop until proper key is read
+  // draw an inverted line between stacked panes
   //
-  while (1) {
+  if (E.split == SPLIT_HORIZONTAL) {
+    poslen = snprintf(pos, sizeof(pos), "\x1b[%d;1H", E.panes[1].top);
+    abAppend(ab, pos, poslen);
+    abAppend(ab, "\x1b[7m", 4);
+    for (int x = 0; x < E.termcols; x++) {
+      abAppend(ab, " ", 1);
+    }
+    abAppend(ab, "\x1b[m", 3);
+  }
 
-    // set message at bottom bar
-    //
-    editorSetStatusMessage(prompt, buf);
+  // draw an inverted column between side by side panes
+  // and clear whatever is left past the right pane
+  //
+  else if (E.split == SPLIT_VERTICAL) {
+    for (int y = 0; y < E.termrows; y++) {
+      poslen = snprintf(pos, sizeof(pos), "\x1b[%d;%dH", y + 1, E.panes[1].left);
+      abAppend(ab, pos, poslen);
+      abAppend(ab, "\x1b[7m \x1b[m", 8);
+      poslen = snprintf(pos, sizeof(pos), "\x1b[%d;%dH", y + 1, E.panes[1].left + E.panes[1].cols + 1);
+      abAppend(ab, pos, poslen);
+      abAppend(ab, "\x1b[K", 3);
+    }
+  }
+}
 
-    // update viewing screen
-    //
-    editorRefreshScreen();
-    
-    // read key presses
-    //
-    int c = editorReadKey();
+/* End Split Panes */
 
-    // allow user to backspace
-    //
-    if (c == BACKSPACE) {
-      if (buflen != 0) {
-         buf[--buflen] = '\0';
-      }
+
+
+/* Keypress Actions */
+
+int editorKeyChild(int node, unsigned char byte, int create) {
+  struct editorInput *in = &E.input;
+
+  // look through the bytes that can follow
+  //
+  int prev = -1;
+  int next = in->nodes[node].child;
+  while (next >= 0) {
+    if (in->nodes[next].byte == byte) {
+      return next;
     }
+    prev = next;
+    next = in->nodes[next].sibling;
+  }
+  if (!create) {
+    return -1;
+  }
 
-    // if escape is pressed
-    // cancel the prompt
-    //
-    else if (c == '\x1b') {
-      editorSetStatusMessage("");
+  // add it to the end of them
+  //
+  if (in->nnodes == in->capnodes) {
+    in->capnodes *= 2;
+    in->nodes = realloc(in->nodes, sizeof(struct editorKeyNode) * in->capnodes);
+  }
+  int n = in->nnodes++;
+  in->nodes[n].byte = byte;
+  in->nodes[n].key = 0;
+  in->nodes[n].child = -1;
+  in->nodes[n].sibling = -1;
+  if (prev < 0) {
+    in->nodes[node].child = n;
+  }
+  else {
+    in->nodes[prev].sibling = n;
+  }
+  return n;
+}
 
+void editorKeyAdd(const char *seq, int key) {
+  int node = 0;
+  for (int i = 0; seq[i]; i++) {
+    node = editorKeyChild(node, seq[i], 1);
+  }
+  E.input.nodes[node].key = key;
+}
 
-      if (callback) {
-        callback(buf, c);
-      }
-      free(buf);
-      return NULL;
+void editorInputInit() {
+  struct editorInput *in = &E.input;
+
+  // escape sequences terminals send for keys, each one
+  // also comes with modifiers as a second parameter
+  // holding one more than shift 1, alt 2 and ctrl 4
+  //
+  static const struct { const char *seq; int key; } keys[] = {
+    {"\x1b[A", ARROW_UP}, {"\x1b[B", ARROW_DOWN},
+    {"\x1b[C", ARROW_RIGHT}, {"\x1b[D", ARROW_LEFT},
+    {"\x1b[H", HOME_KEY}, {"\x1b[F", END_KEY},
+    {"\x1b[1~", HOME_KEY}, {"\x1b[3~", DEL_KEY},
+    {"\x1b[4~", END_KEY}, {"\x1b[5~", PAGE_UP},
+    {"\x1b[6~", PAGE_DOWN}, {"\x1b[7~", HOME_KEY},
+    {"\x1b[8~", END_KEY},
+    {"\x1bOA", ARROW_UP}, {"\x1bOB", ARROW_DOWN},
+    {"\x1bOC", ARROW_RIGHT}, {"\x1bOD", ARROW_LEFT},
+    {"\x1bOH", HOME_KEY}, {"\x1bOF", END_KEY},
+  };
+
+  // start with just the root
+  //
+  in->capnodes = 64;
+  in->nodes = malloc(sizeof(struct editorKeyNode) * in->capnodes);
+  in->nnodes = 1;
+  in->nodes[0].byte = 0;
+  in->nodes[0].key = 0;
+  in->nodes[0].child = -1;
+  in->nodes[0].sibling = -1;
+
+  for (unsigned int k = 0; k < sizeof(keys) / sizeof(keys[0]); k++) {
+    const char *seq = keys[k].seq;
+    int len = strlen(seq);
+    editorKeyAdd(seq, keys[k].key);
+    if (seq[1] != '[') {
+      continue;
     }
 
-    // if character press is enter
+    // CSI 1;5C for a final letter and CSI 3;5~ for a number
     //
-    else if (c == '\r') {
-
-      // confirm their input is not empty
-      // and return
-      //
-      if (buflen != 0) {
-        editorSetStatusMessage("");
-        if (callback) {
-          callback(buf, c);
-        }
-        return buf;
+    for (int m = 2; m <= 8; m++) {
+      int mods = ((m - 1) & 1 ? KEY_SHIFT : 0) | ((m - 1) & 2 ? KEY_ALT : 0) | ((m - 1) & 4 ? KEY_CTRL : 0);
+      char buf[16];
+      if (len == 3) {
+        snprintf(buf, sizeof(buf), "\x1b[1;%d%c", m, seq[2]);
       }
-    } 
-    // otherwise if they're not trying to cancel
-    // or select another special character
+      else {
+        snprintf(buf, sizeof(buf), "%.*s;%d~", len - 1, seq, m);
+      }
+      editorKeyAdd(buf, keys[k].key | mods);
+    }
+
+    // some terminals send alt as an escape in front
     //
-    else if (!iscntrl(c) && c < 128) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "\x1b%s", seq);
+    editorKeyAdd(buf, keys[k].key | KEY_ALT);
+  }
 
-      // if the bufflen is full
-      // increase the size by double
-      //
-      if (buflen == bufsize - 1) {
-        bufsize *= 2;
-        buf = realloc(buf, bufsize);
-      }
+  // how long to wait for the rest of a sequence
+  //
+  char *env = getenv("KILO_ESC_TIMEOUT");
+  in->timeout = env && env[0] ? atoi(env) : KILO_ESC_TIMEOUT;
+}
 
-      // add the character to the buf
-      // and also add a null terminating character
-      //
-      buf[buflen++] = c;
-      buf[buflen] = '\0';
+int editorInputFill(int timeout) {
+  struct editorInput *in = &E.input;
+
+  // take another byte, waiting for one through the event
+  // loop so nothing stalls, 0 when none came in time
+  //
+  while (in->len < (int)sizeof(in->buf)) {
+    char c;
+    int nread = E.term->read(&c);
+    if (nread == 1) {
+      in->buf[in->len++] = c;
+      return 1;
     }
-    if (callback) {
-      callback(buf, c);
+    if (nread == -1 && errno != EAGAIN && errno != EINTR) {
+      die("read");
+    }
+    if (!editorEventsWait(timeout)) {
+      return 0;
     }
   }
+  return 0;
 }
 
-/* End Editor Initialization and File Handline */
-
-
-
-/* Keypress Actions */
-
 int editorReadKey() {
-  
-  // nread keeps track of the return value for read
+
+  // wait for input, coloring rows as the
+  // background highlighter finishes them
   //
-  int nread;
-  
-  // storage point for holding the character read
+  long long start = editorStatsClock();
+  if (E.input.len == 0) {
+    editorEventsWait(-1);
+  }
+
+  // time turning the bytes into a key, the frame
+  // that shows it is timed from here
   //
-  char c;
-  
-  // Says when nread reads a single byte, return it
+  // a replayed trace hands over keys already decoded
   //
-  while ((nread = read(STDIN_FILENO, &c, 1)) != 1) {
-    if (nread == -1 && errno != EAGAIN) die("read");
+  long long ready = editorStatsClock();
+  int c = E.trace.replay ? editorTraceNext() : editorDecodeKey();
+  long long now = editorStatsClock();
+  editorStatsAdd(STAGE_READ, now - ready);
+  E.stats.reading += now - start;
+  E.stats.key_time = now;
+  if (E.trace.record) {
+    editorTraceWrite(c, now);
   }
+  return c;
+}
+
+int editorDecodeKey() {
+  struct editorInput *in = &E.input;
 
-  // if it reads an escape sequence
+  // follow the bytes down the trie as long as they can
+  // still be part of a sequence, remembering the longest
+  // one that is a key, more bytes are waited for only
+  // while a sequence is unfinished
   //
-  if (c == '\x1b') {
-    
-    // declare a buffer to read into
-    //
-    char seq[3];
-    
-    // if it can't read into buffer, then return the plain escape
-    // sequence
-    //
-    if (read(STDIN_FILENO, &seq[0], 1) != 1) {
-      return '\x1b';
+  int node = 0;
+  int key = 0;
+  int keylen = 0;
+  int i = 0;
+  while (1) {
+    if (i == in->len && !editorInputFill(i == 0 ? -1 : in->timeout)) {
+      break;
     }
-    if (read(STDIN_FILENO, &seq[1], 1) != 1) {
-      return '\x1b';
+    node = editorKeyChild(node, in->buf[i], 0);
+    if (node < 0) {
+      break;
     }
-    // if the first character is indicative 
-    //
-    if (seq[0] == '[') {
-
-      // /if the byte after is a digit
-      //
-      if (seq[1] >= '0' && seq[1] <= '9') {
-
-        // if it can't read the digit return the escape character
-        //
-        if (read(STDIN_FILENO, &seq[2], 1) != 1){
-          return '\x1b';
-        }
-
-        // if there is a tilda check whether the 
-        // previous number fulfills the escape sequence
-        //
-        if (seq[2] == '~') {
-          switch (seq[1]) {
-            case '1': return HOME_KEY;
-            case '3': return DEL_KEY;
-            case '4': return END_KEY;
-            case '5': return PAGE_UP;
-            case '6': return PAGE_DOWN;
-            case '7': return HOME_KEY;
-            case '8': return END_KEY;
-          }
-        }
-      }
-      else {
-
-        // check for the correlating arrow key to return
-        //
-        switch (seq[1]) {
-          case 'A': return ARROW_UP;
-          case 'B': return ARROW_DOWN;
-          case 'C': return ARROW_RIGHT;
-          case 'D': return ARROW_LEFT;
-          case 'H': return HOME_KEY;
-          case 'F': return END_KEY;
-
-        }
-      }
+    i++;
+    if (in->nodes[node].key) {
+      key = in->nodes[node].key;
+      keylen = i;
     }
-
-    // check for more escape sequences indicating the home
-    // or end key
-    //
-    else if (seq[0] == 'O') {
-      switch (seq[1]) {
-        case 'H': return HOME_KEY;
-        case 'F': return END_KEY;
-      }
+    if (in->nodes[node].child < 0) {
+      break;
     }
-    return '\x1b';
-  } 
-  
-  else {
-    return c;
   }
+
+  // a byte that starts no sequence is a key by itself, a
+  // sequence that is not known is dropped as far as it
+  // got and read as the escape key
+  //
+  if (keylen == 0) {
+    key = in->buf[0];
+    keylen = (key == '\x1b' && i > 1) ? i : 1;
+  }
+  in->len -= keylen;
+  memmove(in->buf, in->buf + keylen, in->len);
+  return key;
 }
 
 void editorProcessKeypress() {
@@ -2335,7 +9981,38 @@ void editorProcessKeypress() {
   // read a single byte
   //
   int c = editorReadKey();
-  int work;
+
+  // ctrl or alt with left and right moves by words and with
+  // down adds a cursor below, other modifiers are not bound
+  // and the plain key is meant
+  //
+  int plain = c & ~KEY_MODIFIERS;
+  if ((c & (KEY_CTRL | KEY_ALT)) && (plain == ARROW_LEFT || plain == ARROW_RIGHT || plain == ARROW_DOWN)) {
+    c = plain | KEY_CTRL;
+  }
+  else {
+    c = plain;
+  }
+
+  // the viewer only moves around the file
+  //
+  if (E.view.active && !editorViewAllows(c)) {
+    editorSetStatusMessage("Read only view");
+    return;
+  }
+
+  // with several cursors the key may go to all of them
+  //
+  if (E.cursors.n > 0 && editorCursorsKey(c)) {
+    quit_times = KILO_QUIT_TIMES;
+    return;
+  }
+
+  // keys that do not move the cursor end the selection
+  //
+  if (E.sel.active && !editorSelectionKeeps(c)) {
+    editorSelectionClear();
+  }
 
   // printf("%d ",c);
   // handle error checking
@@ -2352,7 +10029,7 @@ void editorProcessKeypress() {
       
       // check to see if the file is modified and if quit times is zero
       //
-       if (E.dirty && quit_times > 0) {
+       if (editorIsDirty() && quit_times > 0) {
 
         // warn the user about unsaved changes
         //
@@ -2364,10 +10041,17 @@ void editorProcessKeypress() {
         return;
       }
 
+      // with other files open only close this one
+      //
+      if (E.numbuffers > 1) {
+        editorBufferClose();
+        break;
+      }
+
       // clear the screen and exit the program
       //
-      write(STDOUT_FILENO, "\x1b[2J", 4);
-      write(STDOUT_FILENO, "\x1b[H", 3);
+      E.term->write("\x1b[2J", 4);
+      E.term->write("\x1b[H", 3);
       exit(0);
       break;  
     
@@ -2404,33 +10088,7 @@ void editorProcessKeypress() {
     //
     case PAGE_UP:
     case PAGE_DOWN:
-
-      // if page up then set cy to row offset
-      //
-      if (c == PAGE_UP) {
-          E.cy = E.rowoff;
-      }
-
-      // if page down then set cy to the screenrows
-      // minus the rowoffset
-      //
-      else if (c == PAGE_DOWN) {
-          E.cy = E.rowoff + E.screenrows - 1;
-
-          // if scrolled past the visible screen
-          // set it to the bottom
-          //
-          if (E.cy > E.numrows) {
-            E.cy = E.numrows;
-          }
-      }
-
-      // scroll one visible page length
-      //
-      int times = E.screenrows; 
-      while (times--){
-        editorMoveCursor(c == PAGE_UP ? ARROW_UP : ARROW_DOWN);
-      }
+      editorPageMove(c == PAGE_UP ? -1 : 1);
       break;
 
     case ARROW_UP:
@@ -2440,26 +10098,91 @@ void editorProcessKeypress() {
       editorMoveCursor(c);
       break;
 
-    case CTRL_KEY('l'):
-    case '\x1b':
-      work = editorReadKey();
+    case ARROW_LEFT | KEY_CTRL:
+      editorMoveCursorLeftWord();
+      break;
 
-      if (work == 53) {
-        work = editorReadKey();
+    case ARROW_RIGHT | KEY_CTRL:
+      editorMoveCursorRightWord();
+      break;
 
-        if (work == 68) {
-          editorMoveCursorLeftWord();
-        }
-        else if (work == 67) {
-          editorMoveCursorRightWord();
-        }
+    case ARROW_DOWN | KEY_CTRL:
+      editorCursorsBelow();
+      break;
+
+    case CTRL_KEY('p'):
+      if (E.sel.active) {
+        editorSelectionCursors();
+      }
+      else {
+        editorCursorsFind();
       }
       break;
 
+    case CTRL_KEY('@'):
+      editorSelectionToggle();
+      break;
+
+    case CTRL_KEY('c'):
+      editorCopy();
+      break;
+
+    case CTRL_KEY('x'):
+      editorCut();
+      break;
+
+    case CTRL_KEY('v'):
+      editorPaste();
+      break;
+
+    case CTRL_KEY('l'):
+    case '\x1b':
+      break;
+
     case CTRL_KEY('f'):
       editorFind();
       break;
 
+    case CTRL_KEY('w'):
+      editorToggleWrap();
+      break;
+
+    case CTRL_KEY('g'):
+      editorGotoLine();
+      break;
+
+    case CTRL_KEY('o'):
+      editorBufferOpen();
+      break;
+
+    case CTRL_KEY('n'):
+      editorBufferSwitch((E.curbuf + 1) % E.numbuffers);
+      break;
+
+    case CTRL_KEY('t'):
+      editorToggleSplit();
+      break;
+
+    case CTRL_KEY('u'):
+      editorPaneSwitch();
+      break;
+
+    case CTRL_KEY('b'):
+      editorBracketJump();
+      break;
+
+    case CTRL_KEY('y'):
+      editorFoldToggle();
+      break;
+
+    case CTRL_KEY('r'):
+      editorReload();
+      break;
+
+    case CTRL_KEY('d'):
+      editorStatsToggle();
+      break;
+
     default:
       editorInsertChar(c);
       break;
@@ -2480,6 +10203,20 @@ quit_times = KILO_QUIT_TIMES;
 
 void editorScroll() {
 
+  // move the window of the viewer along
+  // with the cursor
+  //
+  if (E.view.active) {
+    editorViewShift();
+  }
+
+  // open the fold the cursor landed in
+  //
+  if (E.cy < E.numrows && editorFoldHidden(E.cy)) {
+    int i = editorFoldFind(E.cy);
+    editorFoldSet(E.folds.f[i].start, E.folds.f[i].end, 0);
+  }
+
   // if the cursor y position is < than the cursor position
   // set the proper rx position
   //
@@ -2488,18 +10225,29 @@ void editorScroll() {
     E.rx = editorRowCxToRx(&E.row[E.cy], E.cx);
   }
 
+  // visual line the cursor is on
+  //
+  int line = editorCursorLine();
+
   // if the cursor is above the visible window
   // change the top of the window
   //
-  if (E.cy < E.rowoff) {
-    E.rowoff = E.cy;
+  if (line < E.rowoff) {
+    E.rowoff = line;
   }
 
   // if the cursor is below the visible window
   // change the bottom of the window
   //
-  if (E.cy >= E.rowoff + E.screenrows) {
-    E.rowoff = E.cy - E.screenrows + 1;
+  if (line >= E.rowoff + E.screenrows) {
+    E.rowoff = line - E.screenrows + 1;
+  }
+
+  // wrapped rows never scroll sideways
+  //
+  if (E.wrap) {
+    E.coloff = 0;
+    return;
   }
 
   // if cursor goes to the left of the visible window
@@ -2528,7 +10276,7 @@ int getWindowSize(int *rows, int *cols) {
   // places size of the window into a struct and checks
   // to see if the dimensions are non-zero
   //
-  if (1 || ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == -1 || ws.ws_col == 0) {
+  if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == -1 || ws.ws_col == 0) {
     
     // 999C moves cursor right and 999B moves cursord down
     // each by 999 steps
@@ -2561,88 +10309,459 @@ int getWindowSize(int *rows, int *cols) {
 }
 
 void editorRefreshScreen() {
+
+  // declare buffer
+  //
+  struct abuf ab = ABUF_INIT;
+
+  // build the frame
+  //
+  editorRenderScreen(&ab);
+
+  // write out the append buffer stats and free
+  // the appended buffer
+  //
+  long long start = editorStatsClock();
+  E.term->write(ab.b, ab.len);
+  abFree(&ab);
+
+  // the key read last is on the screen now
+  //
+  long long now = editorStatsClock();
+  editorStatsAdd(STAGE_WRITE, now - start);
+  if (E.stats.key_time) {
+    editorStatsAdd(STAGE_PAINT, now - E.stats.key_time);
+    E.stats.key_time = 0;
+  }
+}
+
+void editorRenderScreen(struct abuf *ab) {
   
   // scroll to keep the cursor within the
   // visible window
   //
+  long long start = editorStatsClock();
   editorScroll();
+  editorStatsAdd(STAGE_SCROLL, editorStatsClock() - start);
 
-  // declare buffer
+  // hand the rows that are about to be shown
+  // to the background highlighter
   //
-  struct abuf ab = ABUF_INIT;
+  editorHighlightSchedule();
+
+  // find the bracket to show as matching
+  // the one at the cursor
+  //
+  editorBracketMark();
+
+  // follow the cursor with the selection
+  //
+  editorSelectionUpdate();
 
   // \x1b is the escape character
   //
 
   // hide the cursor
   //
-  abAppend(&ab, "\x1b[?25l", 6);
+  abAppend(ab, "\x1b[?25l", 6);
 
   // [2j is erasing all of the display
   //
-  // abAppend(&ab, "\x1b[2J", 4);
+  // abAppend(ab, "\x1b[2J", 4);
 
-  // [H moves the cursor to the top left position
+  // draw every pane that changed, each pane gets its view
+  // loaded into the config while it is drawn
   //
-  abAppend(&ab, "\x1b[H", 3);
+  int drawn = 0;
+  start = editorStatsClock();
+  editorPaneStash(&E.panes[E.curpane]);
+  for (int i = 0; i < E.numpanes; i++) {
+    editorPaneLoad(&E.panes[i]);
+    drawn |= editorDrawPane(ab, &E.panes[i]);
+  }
+  editorPaneLoad(&E.panes[E.curpane]);
+  editorStatsAdd(STAGE_DRAW, editorStatsClock() - start);
 
-  // draw rows and move the cursor back to the top 
-  // left of the screen
+  // draw the lines between the panes
+  // whenever a pane was drawn over them
   //
-  editorDrawRows(&ab);
+  if (drawn) {
+    editorDrawSeparators(ab);
+  }
   
   // draw the status bar
   //
-  editorDrawStatusBar(&ab);
+  editorDrawStatusBar(ab);
 
   // draw the message b ar
   //
-  editorDrawMessageBar(&ab);
+  editorDrawMessageBar(ab);
+
+  // draw the other cursors over the rows
+  //
+  editorCursorsDraw(ab);
 
   // initialize buffer length
   //
   char buf[32];
 
   // write the cursor position escape sequence
+  // relative to the active pane
   //
-  snprintf(buf, sizeof(buf), "\x1b[%d;%dH", (E.cy - E.rowoff) + 1, (E.rx - E.coloff) + 1);
-  abAppend(&ab, buf, strlen(buf));
+  int cursorcol = E.wrap ? E.rx % editorWrapWidth() : E.rx - E.coloff;
+  snprintf(buf, sizeof(buf), "\x1b[%d;%dH", E.screentop + (editorCursorLine() - E.rowoff) + 1, E.screenleft + cursorcol + 1);
+  abAppend(ab, buf, strlen(buf));
   
   // unhide the cursor
   //
-  abAppend(&ab, "\x1b[?25h", 6);
+  abAppend(ab, "\x1b[?25h", 6);
+}
 
-  // write out the append buffer stats and free
-  // the appended buffer
+/* End Terminal Viewing Actions*/
+
+
+
+/* Benchmarks */
+
+#ifdef KILO_BENCH
+
+int editorBenchLine(long i, char *buf, int size) {
+
+  // a mix of the kinds of rows source files are made
+  // of, with the braces and comments balanced
   //
-  write(STDOUT_FILENO, ab.b, ab.len);
-  abFree(&ab);
+  switch (i % 8) {
+    case 0: return snprintf(buf, size, "static int counter%ld = %ld;", i, i * 7);
+    case 1: return snprintf(buf, size, "\tif (value%ld > 0x%lx) {", i, i);
+    case 2: return snprintf(buf, size, "\t\tcall_%ld(\"text %ld\", %ld.5);", i % 97, i, i);
+    case 3: return snprintf(buf, size, "\t}");
+    case 4: return snprintf(buf, size, "/* block comment %ld", i);
+    case 5: return snprintf(buf, size, "   still in the comment */ return %ld;", i);
+    case 6: return snprintf(buf, size, "// line comment for row %ld", i);
+    default: return snprintf(buf, size, "typedef struct node%ld { char *name; } node%ld;", i % 13, i % 13);
+  }
+}
+
+void editorBenchReset() {
 
+  // throw the rows of the last run away and start
+  // an empty C file
+  //
+  for (int j = 0; j < E.numrows; j++) {
+    editorFreeRow(&E.row[j]);
+  }
+  free(E.row);
+  free(E.filename);
+  editorLayoutFree();
+  editorSymbolsFree(&E.symbols);
+  free(E.brackets.tree);
+  free(E.folds.f);
+  free(E.hashes.saved);
+  editorBufferReset();
+  E.filename = strdup("bench.c");
+  editorSelectSyntaxHighlight();
 }
 
-/* End Terminal Viewing Actions*/
+void editorBenchStart(struct editorBenchClock *c) {
+  c->allocs = editorBenchAllocs;
+  clock_gettime(CLOCK_MONOTONIC, &c->start);
+}
+
+void editorBenchStop(struct editorBenchClock *c, long lines, const char *name, long ops, long long bytes) {
+
+  // report the run per operation
+  //
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  double ns = (end.tv_sec - c->start.tv_sec) * 1e9 + (end.tv_nsec - c->start.tv_nsec);
+  if (ops < 1) {
+    ops = 1;
+  }
+  printf("%10ld  %-22s %12.1f %12.2f", lines, name, ns / ops, (double)(editorBenchAllocs - c->allocs) / ops);
+  if (bytes >= 0) {
+    printf(" %12lld", bytes / ops);
+  }
+  printf("\n");
+  fflush(stdout);
+}
+
+int editorBench(int argc, char **argv) {
+
+  // a screen without a terminal and the syntax
+  // definitions, the highlighter stays synchronous
+  //
+  editorSyntaxInit();
+  editorBufferReset();
+  E.buffers = malloc(sizeof(struct editorBuffer));
+  E.numbuffers = 1;
+  E.curbuf = 0;
+  E.termrows = 48;
+  E.termcols = 160;
+  E.numpanes = 1;
+  E.curpane = 0;
+  E.split = SPLIT_NONE;
+  memset(E.panes, 0, sizeof(E.panes));
+  editorPanesLayout();
+  E.watch = -1;
+  E.events.timer = -1;
+  E.events.signal = -1;
+
+  // file sizes to run on, from the command line or
+  // a thousand rows up to a million
+  //
+  long defaults[] = {1000, 10000, 100000, 1000000};
+  int nsizes = argc > 0 ? argc : (int)(sizeof(defaults) / sizeof(defaults[0]));
+
+  printf("%10s  %-22s %12s %12s %12s\n", "lines", "operation", "ns/op", "allocs/op", "bytes/op");
+  for (int k = 0; k < nsizes; k++) {
+    long n = argc > 0 ? atol(argv[k]) : defaults[k];
+    if (n < 1) {
+      continue;
+    }
+    editorBenchReset();
+    struct editorBenchClock c;
+    char line[128];
+    uint32_t seed = 1;
+
+    // appending rows the way a file is read
+    //
+    editorBenchStart(&c);
+    for (long i = 0; i < n; i++) {
+      int len = editorBenchLine(i, line, sizeof(line));
+      editorInsertRow(E.numrows, line, len);
+    }
+    editorBenchStop(&c, n, "editorInsertRow", n, -1);
+
+    // typing into rows all over the file
+    //
+    long ops = n < 100000 ? n : 100000;
+    editorBenchStart(&c);
+    for (long i = 0; i < ops; i++) {
+      seed = seed * 1103515245 + 12345;
+      erow *row = &E.row[(seed >> 8) % E.numrows];
+      editorRowInsertChar(row, (seed >> 4) % (row->size + 1), 'x');
+    }
+    editorBenchStop(&c, n, "editorRowInsertChar", ops, -1);
+
+    // highlighting every row again
+    //
+    editorBenchStart(&c);
+    for (int j = 0; j < E.numrows; j++) {
+      editorUpdateSyntax(&E.row[j]);
+    }
+    editorBenchStop(&c, n, "editorUpdateSyntax", E.numrows, -1);
+
+    // searching from the top for a word
+    // only the last row has
+    //
+    editorRowAppendString(&E.row[E.numrows - 1], " needle", 7);
+    ops = 10;
+    editorBenchStart(&c);
+    for (long i = 0; i < ops; i++) {
+      E.cy = 0;
+      E.cx = 0;
+      editorFindCallback("needle", ARROW_DOWN);
+      editorFindCallback("needle", '\x1b');
+    }
+    editorBenchStop(&c, n, "editorFindCallback", ops, -1);
+    if (E.cy != E.numrows - 1) {
+      fprintf(stderr, "search ended on row %d\n", E.cy);
+      return 1;
+    }
+
+    // turning the rows into the file
+    //
+    ops = 3;
+    long long bytes = 0;
+    editorBenchStart(&c);
+    for (long i = 0; i < ops; i++) {
+      int len;
+      char *buf = editorRowsToString(&len);
+      bytes += len;
+      free(buf);
+    }
+    editorBenchStop(&c, n, "editorRowsToString", ops, bytes);
+
+    // drawing whole frames at places all over the file
+    //
+    ops = 200;
+    bytes = 0;
+    editorBenchStart(&c);
+    for (long i = 0; i < ops; i++) {
+      seed = seed * 1103515245 + 12345;
+      E.cy = (seed >> 8) % E.numrows;
+      E.cx = 0;
+      editorPanesTouch(0, INT_MAX);
+      struct abuf ab = ABUF_INIT;
+      editorRenderScreen(&ab);
+      bytes += ab.len;
+      abFree(&ab);
+    }
+    editorBenchStop(&c, n, "editorRefreshScreen", ops, bytes);
+
+    // keys going through the whole editor onto
+    // a screen in memory
+    //
+    static char script[] =
+      "\x1b[B\x1b[B\x1b[B\x1b[6~\x1b[6~\x1b[6~hello, world\r"
+      "\x7f\x7f\x1b[A\x1b[C\x1b[C\x1b[5~\x1b[5~\x1b[D\x1b[D";
+    editorHeadlessStart(script, sizeof(script) - 1, E.termrows + 2, E.termcols);
+    E.cy = 0;
+    E.cx = 0;
+    editorBenchStart(&c);
+    while (E.headless.pos < E.headless.nkeys) {
+      editorProcessKeypress();
+      editorRefreshScreen();
+    }
+    editorBenchStop(&c, n, "keystroke", E.headless.frames, E.headless.bytes);
+    E.term = &editorTty;
+
+    // deleting blocks of rows out of the middle
+    // until half of the file is gone
+    //
+    ops = E.numrows / 200 > 0 ? E.numrows / 200 : 1;
+    editorBenchStart(&c);
+    for (long i = 0; i < ops; i++) {
+      editorDelRows(E.numrows / 2, E.numrows / 2 + 100);
+    }
+    editorBenchStop(&c, n, "editorDelRows", ops, -1);
+
+    // what the file ended up costing
+    //
+    editorMemoryReport(stdout);
+  }
+  return 0;
+}
+
+#endif
+
+/* End Benchmarks */
 
 
 
 int main(int argc, char *argv[]) {
 
+  // draw on the terminal unless told otherwise
+  // and decode the escape sequences it sends
+  //
+  E.term = &editorTty;
+  editorInputInit();
+
+  // the benchmark build only runs the benchmarks
+  //
+#ifdef KILO_BENCH
+
+  // compare the row lexers on a file and exit
+  //
+  if (argc == 3 && !strcmp(argv[1], "--bench-syntax")) {
+    editorSyntaxInit();
+    editorBenchSyntax(argv[2]);
+  }
+  return editorBench(argc - 1, argv + 1);
+#endif
+
+  // options that take a file and go before the files
+  // to open
+  //
+  int headless = 0;
+  while (argc >= 3) {
+
+    // write the latency histograms to a file on exit
+    // with --stats
+    //
+    if (!strcmp(argv[1], "--stats")) {
+      E.stats.dump = argv[2];
+      atexit(editorStatsDump);
+    }
+
+    // play a script of keys into a screen in memory with
+    // --headless and report how long the frames took
+    //
+    else if (!strcmp(argv[1], "--headless")) {
+      if (editorHeadlessLoad(argv[2]) == -1) {
+        die("fopen");
+      }
+      headless = 1;
+    }
+
+    // write the keys of the session to a trace with
+    // --record and play one back headless with --replay
+    //
+    else if (!strcmp(argv[1], "--record")) {
+      if (editorTraceRecord(argv[2]) == -1) {
+        die("fopen");
+      }
+    }
+    else if (!strcmp(argv[1], "--replay")) {
+      if (editorTraceLoad(argv[2]) == -1) {
+        die("replay");
+      }
+      headless = 1;
+    }
+    else {
+      break;
+    }
+    argv += 2;
+    argc -= 2;
+  }
+
   // enables byte by byte reading without having to press enter
   //
-  enableRawMode();
+  E.term->open();
   
   // initialize editor
+  // and load the syntax definitions
   //
   initEditor();
+  editorSyntaxInit();
+
+  // a headless run highlights and reads files in line with
+  // the keys so the same script always takes the same path,
+  // KILO_HEADLESS_ASYNC keeps the background highlighter so
+  // keys can race the rows it has in flight
+  //
+  if (!headless) {
+    editorEventsStart();
+    editorDiskStart();
+  }
+  if (!headless || getenv("KILO_HEADLESS_ASYNC")) {
+    editorHighlightStart();
+  }
+
+  // a file opened with -R or --view is shown read only
+  // through a window instead of being loaded
+  //
+  if (argc == 3 && (!strcmp(argv[1], "-R") || !strcmp(argv[1], "--view"))) {
+    editorViewOpen(argv[2]);
+    argc = 1;
+  }
+
+  // a file opened with -f or --follow keeps getting read
+  // as it grows, keeping at most the given number of rows
+  //
+  if ((argc == 3 || argc == 4) && (!strcmp(argv[1], "-f") || !strcmp(argv[1], "--follow"))) {
+    editorFollowStart(argv[2], argc == 4 ? atoi(argv[3]) : 0);
+    argc = 1;
+  }
 
   // open the editor with the appropriate file
+  // and every other file in a buffer of its own
   //
-  if (argc >= 2) {
-    editorOpen(argv[1]);
+  for (int i = 1; i < argc; i++) {
+    if (i > 1) {
+      editorBufferNew();
+    }
+    editorOpen(argv[i]);
   }
+  editorBufferSwitch(0);
 
   // set initial status message
   //
   editorSetStatusMessage("HELP: Ctrl-S = save | Ctrl-Q = quit | Ctrl-f = find");
+  if (headless) {
+    editorRefreshScreen();
+    editorHeadlessRun();
+  }
 
   // infinite loop
   //
@@ -2652,9 +10771,13 @@ int main(int argc, char *argv[]) {
     //
     editorRefreshScreen();
 
-    // process the keypress
+    // process the keypress, leaving out the time
+    // spent waiting for it
     //
+    long long start = editorStatsClock();
+    E.stats.reading = 0;
     editorProcessKeypress();
+    editorStatsAdd(STAGE_PROCESS, editorStatsClock() - start - E.stats.reading);
 
   }
 